@@ -0,0 +1,67 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "my-yolo-inference.h"
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cout << "Correct Usage: ./bench_concurrency your_model your_image [max_threads] [iterations]" << std::endl;
+    return -1;
+  }
+  std::string model = argv[1];
+  std::string image = argv[2];
+  int max_threads = argc > 3 ? std::stoi(argv[3]) : std::thread::hardware_concurrency();
+  int iterations = argc > 4 ? std::stoi(argv[4]) : 50;
+
+  std::ifstream file(image, std::ios::binary | std::ios::ate);
+  if (!file) {
+    std::cerr << "Failed to open image: " << image << std::endl;
+    return -1;
+  }
+  std::vector<char> buffer(file.tellg());
+  file.seekg(0, std::ios::beg);
+  file.read(buffer.data(), buffer.size());
+
+  my_yolo::MyYoloInference engine;
+  if (!engine.loadModel(model.c_str())) {
+    std::cerr << "Error loading model: " << model << std::endl;
+    return -1;
+  }
+
+  double base_fps = 0;
+  std::cout << "threads,fps,speedup" << std::endl;
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    engine.setReplicas(threads);
+
+    std::atomic<int> done{0};
+    auto worker = [&]() {
+      std::vector<char> json(1 << 20);
+      unsigned int needed = 0;
+      while (done.fetch_add(1) < iterations * threads) {
+        engine.inference(buffer.data(), buffer.size(), json.data(), json.size(), &needed);
+      }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; ++t) {
+      pool.emplace_back(worker);
+    }
+    for (auto& t : pool) {
+      t.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double fps = iterations * threads / seconds;
+    if (threads == 1) {
+      base_fps = fps;
+    }
+    std::cout << threads << "," << fps << "," << fps / base_fps << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "decoder.h"
+
+// the per-row decode the post-processors used before: transpose, then cv::minMaxLoc over every row
+static void reference(const cv::Mat& output, const int& nc, const float& threshold, cv::Mat& pred,
+                      std::vector<int>& indices, std::vector<int>& classes) {
+  indices.clear();
+  classes.clear();
+  cv::transpose(output.reshape(1, output.size[1]), pred);
+  for (int r = 0; r < pred.rows; ++r) {
+    cv::Mat scores(1, nc, CV_32FC1, pred.ptr<float>(r) + 4);
+    cv::Point class_id;
+    double max_conf;
+    cv::minMaxLoc(scores, 0, &max_conf, 0, &class_id);
+    if (max_conf > threshold) {
+      indices.emplace_back(r);
+      classes.emplace_back(class_id.x);
+    }
+  }
+}
+
+// compares the vectorized column-wise decoder with the transpose + minMaxLoc decode on detection heads of
+// typical sizes, then times both
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 200;
+  float threshold = 0.5f;
+  std::vector<std::pair<int, int>> heads{{80, 8400}, {80, 2100}, {15, 21504}, {1, 8400}};
+
+  bool ok = true;
+  std::cout << "nc,preds,candidates,match,reference_ms,decoder_ms,speedup" << std::endl;
+  for (const auto& head : heads) {
+    int nc = head.first;
+    int preds = head.second;
+    int sizes[] = {1, 4 + nc, preds};
+    cv::Mat output(3, sizes, CV_32F);
+    // mostly background, like a real head, with a sprinkle of confident predictions
+    cv::randu(output, cv::Scalar(0.0), cv::Scalar(0.45));
+    cv::Mat rows = output.reshape(1, 4 + nc);
+    for (int p = 0; p < preds; p += 50) {
+      rows.at<float>(4 + (p / 50) % nc, p) = 0.8f;
+    }
+
+    cv::Mat pred;
+    std::vector<int> indices, classes;
+    reference(output, nc, threshold, pred, indices, classes);
+    my_yolo::Decoder decoder;
+    decoder.run(output, 4, nc, threshold);
+    bool match = indices == decoder.m_indices && classes == decoder.m_classes;
+    ok = ok && match;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      reference(output, nc, threshold, pred, indices, classes);
+    }
+    double reference_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      decoder.run(output, 4, nc, threshold);
+    }
+    double decoder_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    std::cout << nc << "," << preds << "," << decoder.m_indices.size() << "," << (match ? "yes" : "no") << ","
+              << reference_ms << "," << decoder_ms << "," << reference_ms / decoder_ms << std::endl;
+  }
+
+  if (!ok) {
+    std::cerr << "Decoder candidates differ from the minMaxLoc decode!" << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "preprocessor.h"
+
+// letterboxes caller memory in every pixel format, rows padded to a wider stride, and compares it with
+// converting to BGR first, the way those frames had to be passed before
+static bool benchFormats(const int& iterations, const cv::Size& input, const cv::dnn::Image2BlobParams& params) {
+  const std::vector<std::pair<const char*, my_yolo::PIXEL_FORMAT>> formats{
+      {"bgr", my_yolo::PIXEL_FORMAT::BGR},   {"bgra", my_yolo::PIXEL_FORMAT::BGRA},
+      {"rgb", my_yolo::PIXEL_FORMAT::RGB},   {"gray", my_yolo::PIXEL_FORMAT::GRAY},
+      {"nv12", my_yolo::PIXEL_FORMAT::NV12}, {"i420", my_yolo::PIXEL_FORMAT::I420}};
+  const int width = 1920;
+  const int height = 1080;
+  const int stride = width * 4 + 64;
+  cv::Mat buffer(height * 3 / 2, stride, CV_8UC1);
+  cv::randu(buffer, cv::Scalar::all(0), cv::Scalar::all(255));
+
+  bool ok = true;
+  std::cout << "format,max_abs_diff,convert_ms,direct_ms,speedup" << std::endl;
+  for (const auto& format : formats) {
+    my_yolo::ImageData data{buffer.data, width, height, 0, stride, format.second};
+    cv::Mat bgr, expected, blob;
+    my_yolo::Preprocessor::toBGR(data, bgr);
+    cv::dnn::blobFromImageWithParams(bgr, expected, params);
+    my_yolo::Preprocessor::run(data, blob, input);
+    double diff = cv::norm(expected, blob, cv::NORM_INF);
+    if (diff > 1.5 / 255.0) {
+      ok = false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      my_yolo::Preprocessor::toBGR(data, bgr);
+      my_yolo::Preprocessor::run(bgr, blob, input);
+    }
+    double convert_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      my_yolo::Preprocessor::run(data, blob, input);
+    }
+    double direct_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    std::cout << format.first << "," << diff << "," << convert_ms << "," << direct_ms << ","
+              << convert_ms / direct_ms << std::endl;
+  }
+  return ok;
+}
+
+// compares the fused preprocessing kernel with blobFromImageWithParams, then times both
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 100;
+  cv::Size input(640, 640);
+  std::vector<cv::Size> sizes{{1920, 1080}, {1280, 720}, {640, 480}, {480, 640}, {1333, 777}, {320, 200}};
+
+  cv::dnn::Image2BlobParams params;
+  params.scalefactor = cv::Scalar(1.0 / 255.0, 1.0 / 255.0, 1.0 / 255.0);
+  params.size = input;
+  params.swapRB = true;
+  params.datalayout = cv::dnn::DNN_LAYOUT_NCHW;
+  params.paddingmode = cv::dnn::ImagePaddingMode::DNN_PMODE_LETTERBOX;
+  params.borderValue = cv::Scalar(114, 114, 114);
+
+  bool ok = true;
+  std::cout << "image,max_abs_diff,opencv_ms,fused_ms,speedup" << std::endl;
+  for (const auto& size : sizes) {
+    cv::Mat image(size, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+
+    cv::Mat expected = cv::dnn::blobFromImageWithParams(image, params);
+    cv::Mat blob;
+    my_yolo::Preprocessor::run(image, blob, input);
+
+    // cv::resize interpolates 8-bit images in fixed point, allow one gray level of difference
+    double diff = cv::norm(expected, blob, cv::NORM_INF);
+    if (diff > 1.5 / 255.0) {
+      ok = false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      cv::dnn::blobFromImageWithParams(image, expected, params);
+    }
+    double opencv_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      my_yolo::Preprocessor::run(image, blob, input);
+    }
+    double fused_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    std::cout << size.width << "x" << size.height << "," << diff << "," << opencv_ms << "," << fused_ms << ","
+              << opencv_ms / fused_ms << std::endl;
+  }
+
+  ok = benchFormats(iterations, input, params) && ok;
+
+  if (!ok) {
+    std::cerr << "Fused preprocessing differs from blobFromImageWithParams!" << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -46,15 +46,17 @@ int main(int argc, char* argv[]) {
       continue;
     }
 
-    char json_buffer[20480] = {0};
-    unsigned int json_buffer_len = 0;
-    bool ok = MY_YOLO.inference(buffer.data(), size, json_buffer, &json_buffer_len);
-    std::cout << "result size: " << json_buffer_len << std::endl;
+    // borrowed from the library, no need to guess a buffer size
+    const char* json_result = nullptr;
+    unsigned int json_result_len = 0;
+    bool ok = MY_YOLO.inference(buffer.data(), size, &json_result, &json_result_len);
+    std::cout << "result size: " << json_result_len << std::endl;
     if (!ok) {
       std::cerr << "Inference failed: " << input.input_img << std::endl;
       continue;
     }
-    std::cout << "JSON result for " << input.input_img << ":\n" << json_buffer << std::endl;
+    std::cout << "JSON result for " << input.input_img << ":\n"
+              << std::string(json_result, json_result_len) << std::endl;
   }
   return 0;
 }
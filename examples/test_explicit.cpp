@@ -12,6 +12,7 @@
 typedef bool (*LoadModelFunc)(const char*, int);
 typedef bool (*InferenceFunc)(const char*, const char*);
 typedef void (*GetModelInfoFunc)(char*, unsigned int*);
+typedef void (*SetRenderFunc)(int);
 
 int main() {
   const char* dll_name =
@@ -30,6 +31,7 @@ int main() {
   LoadModelFunc loadModel = (LoadModelFunc)GetProcAddress(handle, "loadModel");
   GetModelInfoFunc getModelInfo = (GetModelInfoFunc)GetProcAddress(handle, "getModelInfo");
   InferenceFunc inference = (InferenceFunc)GetProcAddress(handle, "inference");
+  SetRenderFunc setRender = (SetRenderFunc)GetProcAddress(handle, "setRender");
 #else
   void* handle = dlopen(dll_name, RTLD_LAZY);
   if (!handle) {
@@ -48,9 +50,13 @@ int main() {
   if (!inference) {
     std::cerr << "Failed to get function: inference" << std::endl;
   }
+  SetRenderFunc setRender = (SetRenderFunc)dlsym(handle, "setRender");
+  if (!setRender) {
+    std::cerr << "Failed to get function: setRender" << std::endl;
+  }
 #endif
 
-  if (!loadModel || !getModelInfo || !inference) {
+  if (!loadModel || !getModelInfo || !inference || !setRender) {
     std::cerr << "Failed to get function!" << std::endl;
 #ifdef _WIN32
     FreeLibrary(handle);
@@ -70,6 +76,8 @@ int main() {
       {dir_model + "yolo11n.onnx", 2048, dir_model + "ikun-play.jpg", dir_output + "test_detect.jpg"},
   };
 
+  // 2: draw and show (my_yolo::RENDER_MODE::DISPLAY)
+  setRender(2);
   for (const auto& input : params) {
     bool loaded = loadModel(input.model_path.c_str(), input.metadata_size);
     if (loaded) {
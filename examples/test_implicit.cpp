@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 
+#include "definitions.h"
 #include "my-yolo-inference.h"
 #include "test.h"
 
@@ -16,6 +17,8 @@ int main(int argc, char* argv[]) {
       {dir_model + "yolo11n-pose.onnx", 2048, dir_model + "ikun-dance.jpg", dir_output + "test_pose.jpg"},
       {dir_model + "yolo11n.onnx", 2048, dir_model + "ikun-play.jpg", dir_output + "test_detect.jpg"},
   };
+  // results are written to the output images, and shown as well
+  MY_YOLO.setRender(my_yolo::RENDER_MODE::DISPLAY);
   for (const auto& input : params) {
     bool loaded = MY_YOLO.loadModel(input.model_path.c_str(), input.metadata_size);
     if (loaded) {
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "rotatednms.h"
+
+// the rotated NMS InferenceOBB used before: every pair through cv::rotatedRectangleIntersection
+static void reference(const std::vector<cv::RotatedRect>& boxes, const std::vector<float>& scores,
+                      const float& iou_threshold, std::vector<int>& indices) {
+  indices.clear();
+  std::vector<int> order(boxes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+  std::vector<bool> suppressed(boxes.size(), false);
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (suppressed[order[i]]) continue;
+    indices.push_back(order[i]);
+    for (size_t j = i + 1; j < order.size(); ++j) {
+      if (suppressed[order[j]]) continue;
+      std::vector<cv::Point2f> inter_pts;
+      const cv::RotatedRect& a = boxes[order[i]];
+      const cv::RotatedRect& b = boxes[order[j]];
+      if (cv::rotatedRectangleIntersection(a, b, inter_pts) == cv::INTERSECT_NONE || inter_pts.empty()) continue;
+      float inter_area = static_cast<float>(cv::contourArea(inter_pts));
+      if (inter_area / (a.size.area() + b.size.area() - inter_area) > iou_threshold) suppressed[order[j]] = true;
+    }
+  }
+}
+
+// dense aerial-like scenes: clusters of overlapping rotated boxes around object centers plus scattered ones
+static void scene(cv::RNG& rng, const int& count, std::vector<cv::RotatedRect>& boxes, std::vector<float>& scores) {
+  boxes.clear();
+  scores.clear();
+  std::vector<cv::Point2f> objects(count / 8 + 1);
+  for (auto& o : objects) {
+    o = cv::Point2f(rng.uniform(0.f, 4000.f), rng.uniform(0.f, 4000.f));
+  }
+  for (int i = 0; i < count; ++i) {
+    const cv::Point2f& o = objects[rng.uniform(0, (int)objects.size())];
+    cv::Point2f center(o.x + rng.gaussian(6.0), o.y + rng.gaussian(6.0));
+    cv::Size2f size(rng.uniform(10.f, 80.f), rng.uniform(10.f, 40.f));
+    boxes.emplace_back(center, size, rng.uniform(-90.f, 90.f));
+    scores.emplace_back(rng.uniform(0.25f, 1.0f));
+  }
+}
+
+// the fast rotated NMS must keep exactly the boxes the pairwise implementation keeps
+int main(int argc, char* argv[]) {
+  int scenes = argc > 1 ? std::stoi(argv[1]) : 20;
+  float threshold = 0.5f;
+  cv::RNG rng(12345);
+  my_yolo::RotatedNMS nms;
+
+  bool ok = true;
+  std::cout << "boxes,kept,match,reference_ms,fast_ms,speedup" << std::endl;
+  for (int count : {100, 1000, 5000}) {
+    double reference_ms = 0;
+    double fast_ms = 0;
+    size_t kept = 0;
+    bool match = true;
+    for (int s = 0; s < scenes; ++s) {
+      std::vector<cv::RotatedRect> boxes;
+      std::vector<float> scores;
+      scene(rng, count, boxes, scores);
+
+      std::vector<int> expected, indices;
+      auto start = std::chrono::steady_clock::now();
+      reference(boxes, scores, threshold, expected);
+      reference_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      start = std::chrono::steady_clock::now();
+      nms.run(boxes, scores, nullptr, 0.0f, threshold, indices);
+      fast_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+      kept += indices.size();
+      match = match && expected == indices;
+    }
+    ok = ok && match;
+    std::cout << count << "," << kept / scenes << "," << (match ? "yes" : "no") << "," << reference_ms / scenes
+              << "," << fast_ms / scenes << "," << reference_ms / fast_ms << std::endl;
+  }
+
+  if (!ok) {
+    std::cerr << "Fast rotated NMS differs from the pairwise implementation!" << std::endl;
+    return -1;
+  }
+  return 0;
+}
@@ -1,4 +1,3 @@
-
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include <string>
@@ -8,7 +7,7 @@
 
 int main(int argc, char* argv[]) {
   if (argc < 3) {
-    std::cout << "Correct Usage: ./test_video your_model your_video" << std::endl;
+    std::cout << "Correct Usage: ./test_video your_model your_video [detect_interval]" << std::endl;
     return -1;
   }
   std::string model = argv[1];
@@ -27,47 +26,33 @@ int main(int argc, char* argv[]) {
   std::string json(json_buf, json_size);
   std::cout << json << std::endl;
 
-  cv::VideoCapture cap(video);
-  if (!cap.isOpened()) {
-    std::cerr << "Error loading video: " << video << std::endl;
-    return -1;
+  MY_YOLO.setRender(my_yolo::RENDER_MODE::DRAW);
+  // with an interval, objects are tracked and the network only runs every that many frames
+  if (argc > 3) {
+    MY_YOLO.setTracking(std::stoi(argv[3]));
   }
 
-  double fps = cap.get(cv::CAP_PROP_FPS);
-  int delay = static_cast<int>(1000.0 / fps);
-  cv::Mat frame;
+  // decode, preprocess, forward and postprocess overlap, frames come back drawn and in order
+  double start_time = cv::getTickCount();
   int frame_count = 0;
-
-  while (true) {
-    double start_time = cv::getTickCount();
-    cap >> frame;
-    if (frame.empty()) {
-      std::cout << "video read complete" << std::endl;
-      break;
-    }
-
-    my_yolo::ImageData img_data;
-    img_data.width = frame.cols;
-    img_data.height = frame.rows;
-    img_data.channels = frame.channels();
-    img_data.data = frame.data;
-
-    if (!MY_YOLO.inference(&img_data)) {
-      std::cerr << "Failed to inference at frame " << frame_count << std::endl;
+  bool ok = MY_YOLO.stream(video.c_str(), [&](int frame_index, const std::string& json, my_yolo::ImageData* frame) {
+    if (json.empty()) {
+      std::cerr << "Failed to inference at frame " << frame_index << std::endl;
     }
     ++frame_count;
 
-    double elapsed_time = (cv::getTickCount() - start_time) / cv::getTickFrequency();
-    int frame_delay = std::max(1, delay - static_cast<int>(elapsed_time * 1000));
-
-    cv::imshow("test_video", frame);
-
-    if (cv::waitKey(frame_delay) == 'q') {
-      break;
-    }
+    cv::Mat image(frame->height, frame->width, CV_8UC3, frame->data);
+    cv::imshow("test_video", image);
+    return cv::waitKey(1) != 'q';
+  });
+  if (!ok) {
+    std::cerr << "Error loading video: " << video << std::endl;
+    return -1;
   }
 
-  cap.release();
+  double elapsed_time = (cv::getTickCount() - start_time) / cv::getTickFrequency();
+  std::cout << "video read complete, " << frame_count / elapsed_time << " fps" << std::endl;
+
   cv::destroyAllWindows();
 
   return 0;
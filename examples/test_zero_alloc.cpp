@@ -0,0 +1,284 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "inference.h"
+#include "inferencefactory.h"
+#include "my-yolo-inference.h"
+#include "preprocessor.h"
+
+// every operator new in the process, the library included
+static std::atomic<long> g_news{0};
+
+void* operator new(std::size_t size) {
+  ++g_news;
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// cv::Mat data does not go through operator new, count it at the allocator instead
+class CountingAllocator : public cv::MatAllocator {
+ public:
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags,
+                         cv::UMatUsageFlags usage) const override {
+    ++count;
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage);
+  }
+  bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+    return cv::Mat::getStdAllocator()->allocate(data, flags, usage);
+  }
+  void deallocate(cv::UMatData* data) const override { cv::Mat::getStdAllocator()->deallocate(data); }
+
+  mutable std::atomic<long> count{0};
+};
+
+// synthetic [1, 4 + nc + extra, preds] output with a few confident, partly overlapping boxes; `fill` sets the
+// `extra` task specific rows of the confident predictions
+template <typename F>
+static cv::Mat boxesOutput(const int& nc, const int& extra, const int& preds, F fill) {
+  int sizes[] = {1, 4 + nc + extra, preds};
+  cv::Mat out(3, sizes, CV_32F, cv::Scalar(0));
+  cv::Mat view = out.reshape(1, 4 + nc + extra);
+  for (int i = 0; i < 64; ++i) {
+    int p = i * (preds / 64);
+    view.at<float>(0, p) = 40.0f + (i % 8) * 70.0f;
+    view.at<float>(1, p) = 40.0f + (i / 8) * 70.0f + (i % 3) * 5.0f;
+    view.at<float>(2, p) = 80.0f;
+    view.at<float>(3, p) = 60.0f;
+    view.at<float>(4 + i % nc, p) = 0.6f + (i % 5) * 0.05f;
+    fill(view, 4 + nc, p, i);
+  }
+  return out;
+}
+
+static cv::Mat detectOutput(const int& nc, const int& preds) {
+  return boxesOutput(nc, 0, preds, [](cv::Mat&, int, int, int) {});
+}
+
+// keypoint triplets (x, y, visibility) around the box center, every fifth one hidden
+static cv::Mat poseOutput(const int& nc, const int& kpt_num, const int& preds) {
+  return boxesOutput(nc, kpt_num * 3, preds, [&](cv::Mat& view, int row, int p, int) {
+    for (int k = 0; k < kpt_num; ++k) {
+      view.at<float>(row + k * 3, p) = view.at<float>(0, p) - 30.0f + (k % 8) * 8.0f;
+      view.at<float>(row + k * 3 + 1, p) = view.at<float>(1, p) - 20.0f + (k / 8) * 8.0f;
+      view.at<float>(row + k * 3 + 2, p) = k % 5 ? 0.9f : 0.1f;
+    }
+  });
+}
+
+// angle in radians after the class scores
+static cv::Mat obbOutput(const int& nc, const int& preds) {
+  return boxesOutput(nc, 1, preds, [](cv::Mat& view, int row, int p, int i) {
+    view.at<float>(row, p) = (i % 6) * 0.25f;
+  });
+}
+
+// mask coefficients after the class scores and [1, features, h, w] random protos
+static std::vector<cv::Mat> segmentOutputs(const int& nc, const int& features, const int& preds) {
+  cv::Mat boxes = boxesOutput(nc, features, preds, [&](cv::Mat& view, int row, int p, int i) {
+    for (int j = 0; j < features; ++j) {
+      view.at<float>(row + j, p) = ((i + j) % 7 - 3) * 0.5f;
+    }
+  });
+  int sizes[] = {1, features, 160, 160};
+  cv::Mat protos(4, sizes, CV_32F);
+  cv::Mat flat = protos.reshape(1, features);
+  cv::randu(flat, cv::Scalar::all(-2), cv::Scalar::all(2));
+  return {boxes, protos};
+}
+
+static bool check(const char* name, long news, long mats) {
+  std::cout << name << ": " << news << " operator new, " << mats << " cv::Mat allocations" << std::endl;
+  return news == 0 && mats == 0;
+}
+
+// allocations of `iterations` calls of `f` after a warm-up
+template <typename F>
+static void count(const int& iterations, const CountingAllocator& allocator, F f, long& news, long& mats) {
+  for (int i = 0; i < 3; ++i) {
+    f();
+  }
+  news = g_news;
+  mats = allocator.count;
+  for (int i = 0; i < iterations; ++i) {
+    f();
+  }
+  news = g_news - news;
+  mats = allocator.count - mats;
+}
+
+// the engine on a real model exported at 640: whatever OpenCV allocates inside forward() is measured on a bare net
+// and the single-image path and stream() must not add anything on top of it
+static bool engine(const char* model, const int& iterations, const CountingAllocator& allocator, cv::Mat& image) {
+  my_yolo::MyYoloInference yolo;
+  if (!yolo.loadModel(model)) {
+    std::cerr << "Failed to load model: " << model << std::endl;
+    return false;
+  }
+
+  cv::dnn::Net net = cv::dnn::readNetFromONNX(model);
+  std::vector<cv::String> names = net.getUnconnectedOutLayersNames();
+  std::vector<cv::Mat> outputs;
+  cv::Mat blob;
+  my_yolo::Preprocessor::run(image, blob, cv::Size(640, 640));
+  auto forward = [&]() {
+    net.setInput(blob);
+    net.forward(outputs, names);
+  };
+  long forward_news, forward_mats;
+  count(iterations, allocator, forward, forward_news, forward_mats);
+  std::cout << "forward: " << forward_news << " operator new, " << forward_mats << " cv::Mat allocations"
+            << std::endl;
+
+  my_yolo::ImageData data{image.data, image.cols, image.rows, image.channels()};
+  const void* block = nullptr;
+  unsigned int block_size = 0;
+  long news, mats;
+  auto single = [&]() { yolo.inferenceResults(&data, &block, &block_size); };
+  count(iterations, allocator, single, news, mats);
+  bool ok = check("single image", news - forward_news, mats - forward_mats);
+
+  // the window opens and closes in the last stage, so it spans `iterations` frames of every stage
+  int first = 3;
+  int last = first + iterations;
+  long stream_news = 0, stream_mats = 0;
+  yolo.stream(
+      [&](my_yolo::ImageData* frame) {
+        *frame = data;
+        return true;
+      },
+      [&](int frame_index, const std::string&, my_yolo::ImageData*) {
+        if (frame_index == first) {
+          stream_news = g_news;
+          stream_mats = allocator.count;
+        } else if (frame_index == last) {
+          stream_news = g_news - stream_news;
+          stream_mats = allocator.count - stream_mats;
+          return false;
+        }
+        return true;
+      });
+  ok = check("stream", stream_news - forward_news, stream_mats - forward_mats) && ok;
+  return ok;
+}
+
+// synthetic outputs of one task and the post-processors taken for them
+struct Task {
+  const char* name;
+  std::shared_ptr<const my_yolo::MODEL_INFO> info;
+  std::shared_ptr<my_yolo::InferenceFactory> factory;
+  std::vector<cv::Mat> outputs;
+  std::vector<cv::Mat> tensors;
+  size_t results = 0;
+};
+
+// after a warm-up, letterboxing into a reused blob, copying the outputs into reused tensors, taking the detect,
+// classify, pose (with more keypoints than are stored inline), OBB and segment post-processors from their factories,
+// post-processing and writing JSON into a reused string must not touch the heap; drawing is not part of the check.
+// Segment masks are written as RLE, PNG and bits go through imencode and base64 and polygons through findContours,
+// which all allocate. With a model the engine's single-image path and stream() are checked end to end as well:
+// ./test_zero_alloc [iterations] [model]
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 100;
+  const char* model = argc > 2 ? argv[2] : nullptr;
+  // OpenCV's thread pool allocates a job for every parallel_for_, keep its allocations out of the count
+  cv::setNumThreads(0);
+
+  CountingAllocator allocator;
+  cv::Mat::setDefaultAllocator(&allocator);
+
+  my_yolo::MODEL_INFO info;
+  info.nc = 80;
+  for (int i = 0; i < info.nc; ++i) {
+    info.class_names.emplace_back("class_" + std::to_string(i));
+  }
+  info.model_width = 640;
+  info.model_height = 640;
+  cv::Size size(info.model_width, info.model_height);
+
+  cv::Mat image(720, 1280, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::Mat scores(1, 1000, CV_32F, cv::Scalar(0.01));
+  scores.at<float>(0, 42) = 0.9f;
+
+  my_yolo::MODEL_INFO pose = info;
+  pose.kpt = {my_yolo::KEYPOINTS::kCapacity + 8, 3};
+  my_yolo::MODEL_INFO segment = info;
+  segment.mask_format = my_yolo::MASK_FORMAT::RLE;
+  auto shared = std::make_shared<const my_yolo::MODEL_INFO>(info);
+  std::vector<Task> tasks;
+  tasks.push_back({"detect", shared, nullptr, {detectOutput(info.nc, 8400)}});
+  tasks.push_back({"classify", shared, nullptr, {scores}});
+  tasks.push_back({"pose", std::make_shared<const my_yolo::MODEL_INFO>(pose), nullptr,
+                   {poseOutput(info.nc, pose.kpt.num, 8400)}});
+  tasks.push_back({"obb", shared, nullptr, {obbOutput(info.nc, 8400)}});
+  tasks.push_back({"segment", std::make_shared<const my_yolo::MODEL_INFO>(segment), nullptr,
+                   segmentOutputs(info.nc, 32, 8400)});
+  my_yolo::TASK kinds[] = {my_yolo::TASK::DETECT, my_yolo::TASK::CLASSIFY, my_yolo::TASK::POSE, my_yolo::TASK::OBB,
+                           my_yolo::TASK::SEGMENT};
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    tasks[i].factory = std::make_shared<my_yolo::InferenceFactory>(kinds[i]);
+  }
+
+  // post-processors are taken from their factory for every frame and handed back, as the engine does
+  cv::Mat blob;
+  std::string json;
+  auto frame = [&]() {
+    my_yolo::Preprocessor::run(image, blob, size);
+    for (Task& task : tasks) {
+      task.tensors.resize(task.outputs.size());
+      for (size_t i = 0; i < task.outputs.size(); ++i) {
+        task.outputs[i].copyTo(task.tensors[i]);
+      }
+      my_yolo::InferenceFactory::Handle post = task.factory->Process(image, task.info);
+      task.results = post->process(task.tensors).size();
+      json.clear();
+      post->write(json);
+    }
+  };
+
+  frame();
+  for (const Task& task : tasks) {
+    if (task.results == 0) {
+      std::cerr << "Synthetic " << task.name << " outputs produced no results!" << std::endl;
+      return -1;
+    }
+  }
+
+  long news, mats;
+  count(iterations, allocator, frame, news, mats);
+  bool ok = check("steady state", news, mats);
+  // each task on its own, to tell which one allocates
+  if (!ok) {
+    std::vector<Task> all;
+    all.swap(tasks);
+    for (Task& task : all) {
+      tasks.assign(1, task);
+      count(iterations, allocator, frame, news, mats);
+      check(task.name, news, mats);
+    }
+    tasks.swap(all);
+  }
+  if (model) {
+    ok = engine(model, iterations, allocator, image) && ok;
+  }
+
+  cv::Mat::setDefaultAllocator(nullptr);
+  if (!ok) {
+    std::cerr << "Heap allocations in the steady state!" << std::endl;
+    return -1;
+  }
+  std::cout << tasks[0].results << " detections, " << iterations << " frames without allocations"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include "decoder.h"
+
+#include <algorithm>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace my_yolo {
+
+void Decoder::run(const cv::Mat& output, const int& class_offset, const int& nc, const float& threshold) {
+  CV_Assert(output.type() == CV_32F && output.isContinuous() && output.dims >= 2);
+  m_data = output.ptr<float>();
+  m_preds = output.size[output.dims - 1];
+  m_indices.clear();
+  m_scores.clear();
+  m_classes.clear();
+  if (nc <= 0) {
+    return;
+  }
+
+  m_max.resize(m_preds);
+  m_argmax.resize(m_preds);
+  float* max = m_max.data();
+  float* argmax = m_argmax.data();
+  const float* first = m_data + (size_t)class_offset * m_preds;
+  std::copy(first, first + m_preds, max);
+  std::fill(argmax, argmax + m_preds, 0.0f);
+
+  // one pass per class row, every row is read contiguously; strict greater keeps the first maximum like
+  // cv::minMaxLoc does
+  for (int c = 1; c < nc; ++c) {
+    const float* row = first + (size_t)c * m_preds;
+    int p = 0;
+#if CV_SIMD
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    cv::v_float32 v_c = cv::vx_setall_f32((float)c);
+    for (; p <= m_preds - lanes; p += lanes) {
+      cv::v_float32 v_row = cv::vx_load(row + p);
+      cv::v_float32 v_max = cv::vx_load(max + p);
+      cv::v_float32 greater = cv::v_gt(v_row, v_max);
+      cv::v_store(max + p, cv::v_select(greater, v_row, v_max));
+      cv::v_store(argmax + p, cv::v_select(greater, v_c, cv::vx_load(argmax + p)));
+    }
+#endif
+    for (; p < m_preds; ++p) {
+      if (row[p] > max[p]) {
+        max[p] = row[p];
+        argmax[p] = (float)c;
+      }
+    }
+  }
+
+  // most predictions are below the threshold, whole vectors of them are skipped at once
+  int p = 0;
+#if CV_SIMD
+  const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+  cv::v_float32 v_threshold = cv::vx_setall_f32(threshold);
+  for (; p <= m_preds - lanes; p += lanes) {
+    if (!cv::v_check_any(cv::v_gt(cv::vx_load(max + p), v_threshold))) {
+      continue;
+    }
+    for (int i = p; i < p + lanes; ++i) {
+      if (max[i] > threshold) {
+        m_indices.emplace_back(i);
+        m_scores.emplace_back(max[i]);
+        m_classes.emplace_back((int)argmax[i]);
+      }
+    }
+  }
+#endif
+  for (; p < m_preds; ++p) {
+    if (max[p] > threshold) {
+      m_indices.emplace_back(p);
+      m_scores.emplace_back(max[p]);
+      m_classes.emplace_back((int)argmax[p]);
+    }
+  }
+}
+
+}  // namespace my_yolo
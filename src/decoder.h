@@ -0,0 +1,41 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "global.h"
+
+namespace my_yolo {
+
+// candidate selection straight on the channel-major [1, features, preds] head output: a vectorized column-wise
+// max/argmax over the class rows and a threshold, so nothing is transposed and only surviving predictions are
+// gathered by the caller
+class MYYOLOINFERENCE_API Decoder {
+ public:
+  Decoder() = default;
+  ~Decoder() = default;
+
+  // class scores are the `nc` feature rows starting at `class_offset`
+  void run(const cv::Mat& output, const int& class_offset, const int& nc, const float& threshold);
+
+  int preds() const { return m_preds; }
+  // feature `f` of prediction `p`
+  float at(const int& f, const int& p) const { return m_data[(size_t)f * m_preds + p]; }
+
+  // predictions whose best class score is above the threshold, in prediction order
+  std::vector<int> m_indices;
+  std::vector<float> m_scores;
+  std::vector<int> m_classes;
+
+ private:
+  const float* m_data = nullptr;
+  int m_preds = 0;
+  std::vector<float> m_max;
+  // class index kept as float so it travels in the same vector registers as the scores
+  std::vector<float> m_argmax;
+};
+
+}  // namespace my_yolo
+
+#endif  // DECODER_H
@@ -2,11 +2,20 @@
 #define DEFINITIONS_H
 
 #include <opencv2/core/mat.hpp>
+#include <vector>
 
 namespace my_yolo {
 
 enum class TASK { UNKNOWN = 0, DETECT, SEGMENT, CLASSIFY, POSE, OBB };
 
+// how segment masks are written to JSON: PNG data URI of the box, COCO compressed RLE of the whole image, contour
+// polygons in image coordinates, or row-major bits of the box packed MSB first in base64 with its corner
+enum class MASK_FORMAT { PNG = 0, RLE, POLYGON, BITS };
+
+// what inference does with the image besides producing results: nothing, draw the overlay into it, or draw it
+// and also show it in a window (the path based inference waits for a key)
+enum class RENDER_MODE { NONE = 0, DRAW, DISPLAY };
+
 struct IMGSZ {
   int w;
   int h;
@@ -17,6 +26,55 @@ struct KEYPOINT {
   int dim;
 };
 
+// keypoints of one detection, up to kCapacity stored inline without allocating per result (COCO poses have 17),
+// larger models (68 point faces, 133 point whole bodies) spill to the heap; points below the confidence threshold
+// are (-1, -1)
+struct KEYPOINTS {
+  static constexpr int kCapacity = 32;
+
+  cv::Point2f points[kCapacity];
+  std::vector<cv::Point2f> spill;
+  int count = 0;
+
+  int size() const { return count; }
+  bool empty() const { return count == 0; }
+  void clear() {
+    count = 0;
+    spill.clear();
+  }
+  void push_back(const cv::Point2f& point) {
+    if (count < kCapacity) {
+      points[count++] = point;
+      return;
+    }
+    if (spill.empty()) {
+      spill.assign(points, points + kCapacity);
+    }
+    spill.push_back(point);
+    ++count;
+  }
+  cv::Point2f* data() { return spill.empty() ? points : spill.data(); }
+  const cv::Point2f* data() const { return spill.empty() ? points : spill.data(); }
+  cv::Point2f& operator[](const int& i) { return data()[i]; }
+  const cv::Point2f& operator[](const int& i) const { return data()[i]; }
+  const cv::Point2f& at(const int& i) const { return data()[i]; }
+  cv::Point2f* begin() { return data(); }
+  cv::Point2f* end() { return data() + count; }
+  const cv::Point2f* begin() const { return data(); }
+  const cv::Point2f* end() const { return data() + count; }
+};
+
+// tracking of stream(): the network runs every `interval` frames (0 = off, 1 = every frame) and sooner once a
+// track's confidence decays below `min_confidence` (on the next frame to be forwarded), tracks are predicted in
+// between; only detections scoring at least `high_threshold` start tracks, lower ones can still extend them;
+// tracks unmatched for `max_age` frames end
+struct TRACK_OPTIONS {
+  int interval = 0;
+  float high_threshold = 0.5f;
+  int max_age = 30;
+  float min_confidence = 0.2f;
+};
+
 struct BBOX {
   float x;
   float y;
@@ -31,30 +89,54 @@ struct YOLO_RESULT {
   cv::RotatedRect obb;
   cv::Mat mask;
   float angle;
-  std::vector<cv::Point2f> keypoints;
+  KEYPOINTS keypoints;
+  // stable id of the object across stream frames, -1 when not tracked
+  int track_id = -1;
 };
 
 struct MODEL_INFO {
   float confidence_threshold = 0.5;
   float nms_threshold = 0.5;
   float mask_threshold = 0.5;
+  // NMS only looks at the best max_candidates boxes and keeps at most max_det, 0 = no limit;
+  // agnostic lets boxes of different classes suppress each other
+  int max_candidates = 30000;
+  int max_det = 300;
+  bool agnostic = false;
   std::vector<std::string> class_names;
   int nc = 0;
   int model_width;
   int model_height;
-  int mask_width;
-  int mask_height;
-  int mask_features;
   TASK task;
   KEYPOINT kpt;
+  // batch size the model was exported with
+  int batch = 1;
+  int stride = 32;
+  // letterbox to the smallest stride-aligned input with the image's aspect ratio
+  bool rect = false;
+  // tiled inference for images larger than one tile, 0 = off
+  int tile_size = 0;
+  int tile_overlap = 0;
+  MASK_FORMAT mask_format = MASK_FORMAT::PNG;
+  // approxPolyDP epsilon in pixels for MASK_FORMAT::POLYGON
+  float mask_tolerance = 1.0f;
+  RENDER_MODE render = RENDER_MODE::NONE;
+  TRACK_OPTIONS track;
 };
 
+// memory layout of ImageData::data, the YUV formats are 4:2:0 with the chroma planes right after the luma plane
+enum class PIXEL_FORMAT { BGR = 0, BGRA, RGB, GRAY, NV12, I420 };
+
 class ImageData {
  public:
   unsigned char* data;
   int width;
   int height;
   int channels;
+  // bytes per row (of the luma plane for YUV, I420 chroma rows take half of it), 0 for tightly packed rows
+  int stride = 0;
+  // BGR with channels 4 or 1 is read as BGRA or GRAY
+  PIXEL_FORMAT format = PIXEL_FORMAT::BGR;
 };
 
 }  // namespace my_yolo
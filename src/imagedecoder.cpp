@@ -0,0 +1,77 @@
+#include "imagedecoder.h"
+
+#include <algorithm>
+
+namespace my_yolo {
+
+bool ImageDecoder::jpegSize(const unsigned char* data, const size_t& data_size, cv::Size& size) {
+  if (data_size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+    return false;
+  }
+  size_t pos = 2;
+  while (pos + 4 <= data_size) {
+    if (data[pos] != 0xFF) {
+      return false;
+    }
+    unsigned char marker = data[pos + 1];
+    if (marker == 0xFF) {
+      ++pos;  // fill byte
+      continue;
+    }
+    pos += 2;
+    // standalone markers carry no length
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      continue;
+    }
+    size_t length = (data[pos] << 8) | data[pos + 1];
+    // SOF0..SOF15 except DHT, JPG and DAC share the frame header layout
+    if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+      if (pos + 7 > data_size) {
+        return false;
+      }
+      size.height = (data[pos + 3] << 8) | data[pos + 4];
+      size.width = (data[pos + 5] << 8) | data[pos + 6];
+      return size.width > 0 && size.height > 0;
+    }
+    if (marker == 0xDA || length < 2) {
+      return false;  // scan data reached without a frame header
+    }
+    pos += length;
+  }
+  return false;
+}
+
+cv::Mat ImageDecoder::decode(const void* data, const size_t& data_size, const cv::Size& input, int& scale,
+                             cv::Size& size) {
+  // a header over the caller's bytes, imdecode reads them in place
+  cv::Mat buf(1, (int)data_size, CV_8UC1, const_cast<void*>(data));
+  int flags = cv::IMREAD_COLOR;
+  scale = 1;
+
+  cv::Size jpeg;
+  if (!input.empty() && jpegSize((const unsigned char*)data, data_size, jpeg)) {
+    // the letterbox resize factor, taken for both orientations since EXIF may rotate the decoded image
+    float r = std::max(std::min(input.width / (float)jpeg.width, input.height / (float)jpeg.height),
+                       std::min(input.width / (float)jpeg.height, input.height / (float)jpeg.width));
+    // the reduced image must still be at least as large as the letterboxed one
+    const int reduced[][2] = {{8, cv::IMREAD_REDUCED_COLOR_8}, {4, cv::IMREAD_REDUCED_COLOR_4},
+                              {2, cv::IMREAD_REDUCED_COLOR_2}};
+    for (const auto& reduce : reduced) {
+      if (reduce[0] * r <= 1.0f) {
+        scale = reduce[0];
+        flags = reduce[1];
+        break;
+      }
+    }
+  }
+
+  cv::Mat image = cv::imdecode(buf, flags);
+  size = image.size();
+  if (!image.empty() && scale > 1) {
+    bool rotated = (image.cols > image.rows) != (jpeg.width > jpeg.height);
+    size = rotated ? cv::Size(jpeg.height, jpeg.width) : jpeg;
+  }
+  return image;
+}
+
+}  // namespace my_yolo
@@ -0,0 +1,26 @@
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include <cstddef>
+#include <opencv2/opencv.hpp>
+
+namespace my_yolo {
+
+// decodes an encoded image straight from the caller's buffer; a JPEG several times larger than what the letterbox
+// keeps of it is decoded at 1/2, 1/4 or 1/8 scale by the JPEG decoder itself (IMREAD_REDUCED_COLOR_*)
+class ImageDecoder {
+ public:
+  ImageDecoder() = default;
+  ~ImageDecoder() = default;
+
+  // `scale` receives the factor from decoded to full resolution coordinates, `size` the full resolution size;
+  // an empty `input` always decodes at full resolution
+  static cv::Mat decode(const void* data, const size_t& data_size, const cv::Size& input, int& scale,
+                        cv::Size& size);
+  // frame size from the SOFn segment, without decoding anything
+  static bool jpegSize(const unsigned char* data, const size_t& data_size, cv::Size& size);
+};
+
+}  // namespace my_yolo
+
+#endif  // IMAGEDECODER_H
@@ -0,0 +1,64 @@
+#include "inference.h"
+
+namespace my_yolo {
+
+// whether `view` is already the batch_idx share of `output`
+static bool views(const cv::Mat& view, const cv::Mat& output, const int& batch_idx) {
+  if (view.data != output.ptr(batch_idx) || view.type() != output.type() || view.dims != output.dims ||
+      view.size[0] != 1) {
+    return false;
+  }
+  for (int d = 1; d < output.dims; ++d) {
+    if (view.size[d] != output.size[d]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Inference::slice(const std::vector<cv::Mat>& outputs, const int& batch_idx, std::vector<cv::Mat>& v) {
+  v.resize(outputs.size());
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    const cv::Mat& output = outputs[i];
+    if (views(v[i], output, batch_idx)) {
+      continue;
+    }
+    if (output.dims == 2) {
+      // classify: [bs, num_classes]
+      v[i] = output.row(batch_idx);
+      continue;
+    }
+    // detect/segment/pose/obb: [bs, features, preds_num], segment protos: [bs, mask_features, h, w]
+    int shape[CV_MAX_DIM];
+    for (int d = 0; d < output.dims; ++d) {
+      shape[d] = output.size[d];
+    }
+    shape[0] = 1;
+    v[i] = cv::Mat(output.dims, shape, output.type(), const_cast<uchar*>(output.ptr(batch_idx)));
+  }
+}
+
+void Inference::rescale(const int& factor, const cv::Size& size) {
+  if (factor == 1) {
+    return;
+  }
+  m_size = size;
+  cv::Rect bounds(0, 0, size.width, size.height);
+  for (auto& res : m_result) {
+    res.bbox = cv::Rect(res.bbox.x * factor, res.bbox.y * factor, res.bbox.width * factor,
+                        res.bbox.height * factor) &
+               bounds;
+    res.obb = cv::RotatedRect(res.obb.center * (float)factor, res.obb.size * (float)factor, res.obb.angle);
+    for (auto& kp : res.keypoints) {
+      // keypoints below the confidence threshold stay at (-1, -1)
+      if (kp.x >= 0 && kp.y >= 0) {
+        kp *= (float)factor;
+      }
+    }
+    if (!res.mask.empty() && !res.bbox.empty()) {
+      cv::resize(res.mask, res.mask, res.bbox.size(), 0, 0, cv::INTER_NEAREST);
+    }
+  }
+}
+
+}  // namespace my_yolo
@@ -1,10 +1,13 @@
 #ifndef INFERENCE_H
 #define INFERENCE_H
 
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+#include "decoder.h"
 #include "definitions.h"
+#include "nms.h"
 
 namespace my_yolo {
 
@@ -14,13 +17,38 @@ class Inference {
   virtual ~Inference() = default;
 
  public:
-  virtual std::vector<YOLO_RESULT> process(const std::vector<cv::Mat>&) = 0;
+  virtual const std::vector<YOLO_RESULT>& process(const std::vector<cv::Mat>&) = 0;
   virtual cv::Mat draw() { return cv::Mat(); };
-  virtual std::string str() { return ""; };
-
-  MODEL_INFO m_info;
+  // appends the results as JSON to `out`, which keeps its capacity between calls
+  virtual void write(std::string& out) {}
+  std::string str() {
+    std::string out;
+    write(out);
+    return out;
+  }
+
+  // views of one image's share of batched network outputs, with the batch dimension set to 1; headers already in
+  // `views` are kept when they still point at the right memory, so a repeated batch does not allocate
+  static void slice(const std::vector<cv::Mat>& outputs, const int& batch_idx, std::vector<cv::Mat>& views);
+
+  // maps results found on a reduced decode of the image back to the full `size` image, `factor` times larger
+  void rescale(const int& factor, const cv::Size& size);
+
+  // model info and settings, shared by every post-processor of the model and never modified through them
+  std::shared_ptr<const MODEL_INFO> m_info;
+  // per frame: the image results are found on, and the input size its blob was letterboxed to
   cv::Mat m_image;
+  cv::Size m_input;
+  // size of the image results refer to, m_image's unless rescale mapped them to the full resolution one
+  cv::Size m_size;
   std::vector<YOLO_RESULT> m_result;
+
+ protected:
+  // scratch kept alive between calls, a reused post-processor does not allocate once warmed up
+  Decoder m_decoder;
+  std::vector<cv::Rect> m_boxes;
+  std::vector<int> m_nms_result;
+  NMS m_nms;
 };
 
 }  // namespace my_yolo
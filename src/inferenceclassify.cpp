@@ -1,18 +1,19 @@
 #include "inferenceclassify.h"
 
+#include "jsonwriter.h"
+
 namespace my_yolo {
 
-std::vector<YOLO_RESULT> InferenceClassify::process(const std::vector<cv::Mat> &v) {
-  std::vector<YOLO_RESULT> output;
+const std::vector<YOLO_RESULT> &InferenceClassify::process(const std::vector<cv::Mat> &v) {
+  m_result.clear();
 
   if (v.empty() || v[0].dims != 2) {
     std::cerr << "Invalid output shape for classification model!" << std::endl;
-    return output;
+    return m_result;
   }
 
-  cv::Mat output_scores = v[0];  // shape: (batch_size, num_classes)
+  const cv::Mat &output_scores = v[0];  // shape: (batch_size, num_classes)
   int batch_size = output_scores.rows;
-  int num_classes = output_scores.cols;
 
   for (int i = 0; i < batch_size; ++i) {
     cv::Mat scores_row = output_scores.row(i);
@@ -20,15 +21,14 @@ std::vector<YOLO_RESULT> InferenceClassify::process(const std::vector<cv::Mat> &
     double max_conf;
     minMaxLoc(scores_row, 0, &max_conf, 0, &class_id);
 
-    if (max_conf > m_info.confidence_threshold) {
+    if (max_conf > m_info->confidence_threshold) {
       YOLO_RESULT result;
       result.class_idx = class_id.x;
       result.confidence = max_conf;
 
-      output.emplace_back(result);
+      m_result.emplace_back(result);
     }
   }
-  m_result = output;
   return m_result;
 }
 
@@ -42,7 +42,7 @@ cv::Mat InferenceClassify::draw() {
 
   for (const auto &res : m_result) {
     // handle label
-    std::string label = cv::format("%s %.2f", m_info.class_names[res.class_idx].c_str(), res.confidence);
+    std::string label = cv::format("%s %.2f", m_info->class_names[res.class_idx].c_str(), res.confidence);
     cv::Size text_size = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, font_scale, thickness, &base_line);
     if (start_x + text_size.width > m_image.cols - 10) {
       start_x = 10;
@@ -57,22 +57,13 @@ cv::Mat InferenceClassify::draw() {
   return m_image;
 }
 
-std::string InferenceClassify::str() {
-  std::stringstream ss;
-  ss << "{";
-  ss << "\"classify\":[";
-
-  for (size_t i = 0; i < m_result.size(); ++i) {
-    const auto &res = m_result[i];
-    ss << "{\"" << m_info.class_names[res.class_idx] << "\":" << res.confidence << "}";
-    if (i != m_result.size() - 1) {
-      ss << ",";
-    }
+void InferenceClassify::write(std::string &out) {
+  JsonWriter json(out);
+  json.beginObject().key("classify").beginArray();
+  for (const auto &res : m_result) {
+    json.beginObject().key(m_info->class_names[res.class_idx]).value(res.confidence).endObject();
   }
-
-  ss << "]";
-  ss << "}";
-  return ss.str();
+  json.endArray().endObject();
 }
 
 }  // namespace my_yolo
@@ -10,9 +10,9 @@ class InferenceClassify : public Inference {
 
   // Inference interface
  public:
-  std::vector<YOLO_RESULT> process(const std::vector<cv::Mat> &ptr) override;
+  const std::vector<YOLO_RESULT>& process(const std::vector<cv::Mat> &ptr) override;
   cv::Mat draw() override;
-  std::string str() override;
+  void write(std::string &out) override;
 };
 
 }  // namespace my_yolo
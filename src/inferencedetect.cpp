@@ -1,54 +1,36 @@
 #include "inferencedetect.h"
 
+#include "jsonwriter.h"
 #include "utils.h"
 
 namespace my_yolo {
 
-std::vector<YOLO_RESULT> InferenceDetect::process(const std::vector<cv::Mat>& v) {
-  std::vector<int64_t> box_shape = {v[0].size[0], v[0].size[1], v[0].size[2]};  // [bs, features, preds_num]
-  cv::Mat output_box = v[0].reshape(1, box_shape[1]).t();
-  std::vector<YOLO_RESULT> output;
-  std::vector<int> class_ids;
-  std::vector<float> confidences;
-  std::vector<cv::Rect> boxes;
-  // 4 - your default number of rect parameters {x, y, w, h}
-  int data_width = m_info.nc + 4;
-  int rows = output_box.rows;
-  float* pdata = (float*)output_box.data;
-  for (int r = 0; r < rows; ++r) {
-    cv::Mat scores(1, m_info.nc, CV_32FC1, pdata + 4);
-    cv::Point class_id;
-    double max_conf;
-    cv::minMaxLoc(scores, 0, &max_conf, 0, &class_id);
-    if (max_conf > m_info.confidence_threshold) {
-      class_ids.emplace_back(class_id.x);
-      confidences.emplace_back(max_conf);
+const std::vector<YOLO_RESULT>& InferenceDetect::process(const std::vector<cv::Mat>& v) {
+  // [bs, features, preds_num], features: x, y, w, h, class scores
+  m_decoder.run(v[0], 4, m_info->nc, m_info->confidence_threshold);
+  m_result.clear();
+  m_boxes.clear();
+  for (int p : m_decoder.m_indices) {
+    float out_w = m_decoder.at(2, p);
+    float out_h = m_decoder.at(3, p);
+    float out_left = MAX((m_decoder.at(0, p) - 0.5 * out_w + 0.5), 0);
+    float out_top = MAX((m_decoder.at(1, p) - 0.5 * out_h + 0.5), 0);
+    cv::Rect_<float> bbox = cv::Rect(out_left, out_top, (out_w + 0.5), (out_h + 0.5));
+    cv::Rect_<float> scaled_bbox = Utils::ScaleBox(m_input, bbox, m_image.size());
 
-      float out_w = pdata[2];
-      float out_h = pdata[3];
-      float out_left = MAX((pdata[0] - 0.5 * out_w + 0.5), 0);
-      float out_top = MAX((pdata[1] - 0.5 * out_h + 0.5), 0);
-      cv::Rect_<float> bbox = cv::Rect(out_left, out_top, (out_w + 0.5), (out_h + 0.5));
-      cv::Rect_<float> scaled_bbox =
-          Utils::ScaleBox(cv::Size(m_info.model_width, m_info.model_height), bbox, m_image.size());
-
-      boxes.emplace_back(scaled_bbox);
-    }
-    pdata += data_width;  // next pred
+    m_boxes.emplace_back(scaled_bbox);
   }
 
-  std::vector<int> nms_result;
-  cv::dnn::NMSBoxes(boxes, confidences, m_info.confidence_threshold, m_info.nms_threshold, nms_result);
+  const std::vector<float>& confidences = m_decoder.m_scores;
+  const std::vector<int>& class_ids = m_decoder.m_classes;
+  m_nms.run(m_boxes, confidences, m_info->agnostic ? nullptr : &class_ids, m_info->confidence_threshold,
+            m_info->nms_threshold, m_nms_result, m_info->max_candidates, m_info->max_det);
 
-  cv::Mat proto;
-
-  for (int i = 0; i < nms_result.size(); ++i) {
-    int idx = nms_result[i];
-    boxes[idx] = boxes[idx] & cv::Rect(0, 0, m_image.cols, m_image.rows);
-    YOLO_RESULT result = {class_ids[idx], confidences[idx], boxes[idx]};
-    output.emplace_back(result);
+  for (int idx : m_nms_result) {
+    m_boxes[idx] = m_boxes[idx] & cv::Rect(0, 0, m_image.cols, m_image.rows);
+    YOLO_RESULT result = {class_ids[idx], confidences[idx], m_boxes[idx]};
+    m_result.emplace_back(result);
   }
-  m_result = output;
   return m_result;
 }
 
@@ -62,7 +44,10 @@ cv::Mat InferenceDetect::draw() {
     // handle box
     cv::rectangle(m_image, res.bbox, Utils::Color(res.class_idx), line_width);
     // handle label
-    std::string label = cv::format("%s %.2f", m_info.class_names[res.class_idx].c_str(), res.confidence);
+    std::string label = cv::format("%s %.2f", m_info->class_names[res.class_idx].c_str(), res.confidence);
+    if (res.track_id >= 0) {
+      label = cv::format("#%d ", res.track_id) + label;
+    }
     cv::Size text_size = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.6, thickness, nullptr);
     cv::Rect rect_to_fill(left - 1, top - text_size.height - 5, text_size.width + 2, text_size.height + 5);
     cv::Scalar text_color = cv::Scalar(255.0, 255.0, 255.0);
@@ -72,29 +57,22 @@ cv::Mat InferenceDetect::draw() {
   return m_image;
 }
 
-std::string InferenceDetect::str() {
-  std::stringstream ss;
-  ss << "{";
-  ss << "\"detect\":[";
-
-  for (size_t i = 0; i < m_result.size(); ++i) {
-    const auto& res = m_result[i];
-    ss << "{";
-    ss << "\"" << m_info.class_names[res.class_idx] << "\":{";
-    ss << "\"confidence\":" << res.confidence << ",";
-    ss << "\"x\":" << res.bbox.x << ",";
-    ss << "\"y\":" << res.bbox.y << ",";
-    ss << "\"w\":" << res.bbox.width << ",";
-    ss << "\"h\":" << res.bbox.height;
-    ss << "}}";
-    if (i != m_result.size() - 1) {
-      ss << ",";
+void InferenceDetect::write(std::string& out) {
+  JsonWriter json(out);
+  json.beginObject().key("detect").beginArray();
+  for (const auto& res : m_result) {
+    json.beginObject().key(m_info->class_names[res.class_idx]).beginObject();
+    json.key("confidence").value(res.confidence);
+    if (res.track_id >= 0) {
+      json.key("track_id").value(res.track_id);
     }
+    json.key("x").value(res.bbox.x);
+    json.key("y").value(res.bbox.y);
+    json.key("w").value(res.bbox.width);
+    json.key("h").value(res.bbox.height);
+    json.endObject().endObject();
   }
-
-  ss << "]";
-  ss << "}";
-  return ss.str();
+  json.endArray().endObject();
 }
 
 }  // namespace my_yolo
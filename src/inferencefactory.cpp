@@ -9,32 +9,60 @@
 
 namespace my_yolo {
 
-std::unique_ptr<Inference> InferenceFactory::Process(cv::Mat img, MODEL_INFO info) {
-  std::unique_ptr<Inference> inf;
-  switch (info.task) {
+void InferenceFactory::Release::operator()(Inference* inf) const {
+  if (!inf) {
+    return;
+  }
+  // the frame is dropped, the scratch buffers are kept
+  inf->m_image.release();
+  std::lock_guard<std::mutex> lock(factory->m_mutex);
+  factory->m_free.push_back(inf);
+}
+
+InferenceFactory::~InferenceFactory() {
+  for (Inference* inf : m_free) {
+    delete inf;
+  }
+}
+
+InferenceFactory::Handle InferenceFactory::Process(const cv::Mat& img, const std::shared_ptr<const MODEL_INFO>& info) {
+  Inference* inf = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_free.empty()) {
+      inf = m_free.back();
+      m_free.pop_back();
+    }
+  }
+  if (!inf) {
+    inf = Create(m_task).release();
+    if (!inf) {
+      return Handle(nullptr, Release{nullptr});
+    }
+  }
+  inf->m_info = info;
+  inf->m_image = img;
+  inf->m_size = img.size();
+  inf->m_input = cv::Size(info->model_width, info->model_height);
+  return Handle(inf, Release{shared_from_this()});
+}
+
+std::unique_ptr<Inference> InferenceFactory::Create(const TASK& task) {
+  switch (task) {
     case TASK::DETECT:
-      inf = std::make_unique<InferenceDetect>();
-      break;
+      return std::make_unique<InferenceDetect>();
     case TASK::SEGMENT:
-      inf = std::make_unique<InferenceSegment>();
-      break;
+      return std::make_unique<InferenceSegment>();
     case TASK::CLASSIFY:
-      inf = std::make_unique<InferenceClassify>();
-      break;
+      return std::make_unique<InferenceClassify>();
     case TASK::POSE:
-      inf = std::make_unique<InferencePose>();
-      break;
+      return std::make_unique<InferencePose>();
     case TASK::OBB:
-      inf = std::make_unique<InferenceOBB>();
-      break;
+      return std::make_unique<InferenceOBB>();
     case TASK::UNKNOWN:
-      return nullptr;
-  }
-  if (inf) {
-    inf->m_info = info;
-    inf->m_image = img;
+      break;
   }
-  return inf;
+  return nullptr;
 }
 
 }  // namespace my_yolo
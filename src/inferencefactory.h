@@ -2,17 +2,39 @@
 #define INFERENCEFACTORY_H
 
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "definitions.h"
+#include "global.h"
 
 namespace my_yolo {
 class Inference;
 
-class InferenceFactory {
+// post-processors of one loaded model, created once and handed out again for later frames so their scratch
+// stays warm; model info is shared with them instead of copied
+class MYYOLOINFERENCE_API InferenceFactory : public std::enable_shared_from_this<InferenceFactory> {
  public:
-  InferenceFactory() = default;
-  ~InferenceFactory() = default;
-  static std::unique_ptr<Inference> Process(cv::Mat img, MODEL_INFO info);
+  // gives the post-processor back to its factory instead of deleting it
+  struct Release {
+    std::shared_ptr<InferenceFactory> factory;
+    void operator()(Inference* inf) const;
+  };
+  typedef std::unique_ptr<Inference, Release> Handle;
+
+ public:
+  explicit InferenceFactory(const TASK& task) : m_task(task) {}
+  ~InferenceFactory();
+  // a free post-processor of the model's task (a new one if all are in use) set up for `img`, nullptr for
+  // an unknown task; results of its previous frame are left for process() to replace, so their storage is reused,
+  // callers filling m_result themselves clear it first
+  Handle Process(const cv::Mat& img, const std::shared_ptr<const MODEL_INFO>& info);
+  static std::unique_ptr<Inference> Create(const TASK& task);
+
+ private:
+  TASK m_task;
+  std::mutex m_mutex;
+  std::vector<Inference*> m_free;
 };
 }  // namespace my_yolo
 
@@ -2,6 +2,7 @@
 #define INFERENCEOBB_H
 
 #include "inference.h"
+#include "rotatednms.h"
 
 namespace my_yolo {
 class InferenceOBB : public Inference {
@@ -10,9 +11,13 @@ class InferenceOBB : public Inference {
 
   // Inference interface
  public:
-  std::vector<YOLO_RESULT> process(const std::vector<cv::Mat> &) override;
+  const std::vector<YOLO_RESULT>& process(const std::vector<cv::Mat> &) override;
   cv::Mat draw() override;
-  std::string str() override;
+  void write(std::string &out) override;
+
+ private:
+  std::vector<cv::RotatedRect> m_rboxes;
+  RotatedNMS m_rnms;
 };
 
 }  // namespace my_yolo
@@ -1,86 +1,73 @@
 #include "inferencepose.h"
 
+#include <charconv>
+
+#include "jsonwriter.h"
 #include "utils.h"
 
 namespace my_yolo {
 
-std::vector<YOLO_RESULT> InferencePose::process(const std::vector<cv::Mat> &v) {
-  std::vector<YOLO_RESULT> results;
+const std::vector<YOLO_RESULT> &InferencePose::process(const std::vector<cv::Mat> &v) {
   if (v.empty() || v[0].dims != 3) {
     std::cerr << "Invalid Pose model output shape!" << std::endl;
-    return results;
+    m_result.clear();
+    return m_result;
   }
 
   int batch = v[0].size[0];
-  int feature_dim = v[0].size[1];  // x, y, w, h, conf, keypoints, scores...
-  int num_preds = v[0].size[2];
   if (batch != 1) {
     std::cerr << "Only batch size = 1 is supported!" << std::endl;
-    return results;
+    m_result.clear();
+    return m_result;
   }
 
-  int kpt_num = m_info.kpt.num;
-  int data_width = 4 + kpt_num * m_info.kpt.dim + m_info.nc;
-
-  cv::Mat pred = v[0].reshape(1, feature_dim).t();
-  float *pdata = (float *)pred.data;
-  int rows = pred.rows;
-  std::vector<cv::Rect> boxes;
-  std::vector<std::vector<cv::Point2f>> v_keypoints;
-  std::vector<float> confidences;
-  std::vector<int> class_ids;
-  for (int i = 0; i < rows; ++i) {
-    cv::Mat scores(1, m_info.nc, CV_32FC1, pdata + 4);
-    cv::Point class_id;
-    double max_conf;
-    cv::minMaxLoc(scores, 0, &max_conf, 0, &class_id);
-    if (max_conf > m_info.confidence_threshold) {
-      confidences.push_back(max_conf);
-      class_ids.push_back(class_id.x);
-      float cx = pdata[0];
-      float cy = pdata[1];
-      float w = pdata[2];
-      float h = pdata[3];
-      cv::Rect_<float> box(cx - w / 2, cy - h / 2, w, h);
-      cv::Rect_<float> scaled_bbox =
-          Utils::ScaleBox(cv::Size(m_info.model_width, m_info.model_height), box, m_image.size());
-      std::vector<cv::Point2f> keypoints;
-      for (int k = 0; k < kpt_num; ++k) {
-        float kx = pdata[4 + m_info.nc + k * 3];
-        float ky = pdata[4 + m_info.nc + k * 3 + 1];
-        float kconf = pdata[4 + m_info.nc + k * 3 + 2];
-        if (kconf > m_info.confidence_threshold) {
-          auto kp = Utils::ScalePoint(cv::Size(m_info.model_width, m_info.model_height), m_image.size(), {kx, ky});
-          keypoints.emplace_back(kp);
-        } else {
-          keypoints.emplace_back(-1, -1);
-        }
-      }
-
-      YOLO_RESULT result;
-      result.class_idx = class_id.x;
-      result.confidence = static_cast<float>(max_conf);
-      result.bbox = scaled_bbox;
-      result.keypoints = keypoints;
-      v_keypoints.push_back(keypoints);
-      boxes.emplace_back(scaled_bbox);
-      results.emplace_back(result);
-    }
-    pdata += data_width;
+  // [bs, features, preds_num], features: x, y, w, h, class scores, keypoints of kpt.dim values (x, y[, visibility])
+  int kpt_num = m_info->kpt.num;
+  int kpt_dim = m_info->kpt.dim;
+  int kpt_offset = 4 + m_info->nc;
+  m_decoder.run(v[0], 4, m_info->nc, m_info->confidence_threshold);
+  m_boxes.clear();
+  for (int p : m_decoder.m_indices) {
+    float cx = m_decoder.at(0, p);
+    float cy = m_decoder.at(1, p);
+    float w = m_decoder.at(2, p);
+    float h = m_decoder.at(3, p);
+    cv::Rect_<float> box(cx - w / 2, cy - h / 2, w, h);
+    cv::Rect_<float> scaled_bbox = Utils::ScaleBox(m_input, box, m_image.size());
+    m_boxes.emplace_back(scaled_bbox);
   }
 
-  std::vector<int> nms_result;
-  cv::dnn::NMSBoxes(boxes, confidences, m_info.confidence_threshold, m_info.nms_threshold, nms_result);
-
-  std::vector<YOLO_RESULT> output;
-  for (int i = 0; i < nms_result.size(); ++i) {
-    int idx = nms_result[i];
-    boxes[idx] = boxes[idx] & cv::Rect(0, 0, m_image.cols, m_image.rows);
-    YOLO_RESULT result = {class_ids[idx], confidences[idx], boxes[idx]};
-    result.keypoints = v_keypoints[idx];
-    output.emplace_back(result);
+  const std::vector<float> &confidences = m_decoder.m_scores;
+  const std::vector<int> &class_ids = m_decoder.m_classes;
+  m_nms.run(m_boxes, confidences, m_info->agnostic ? nullptr : &class_ids, m_info->confidence_threshold,
+            m_info->nms_threshold, m_nms_result, m_info->max_candidates, m_info->max_det);
+
+  // keypoints of the survivors only; results are reset in place rather than cleared, so keypoints beyond the
+  // inline capacity keep their storage from frame to frame
+  m_result.resize(m_nms_result.size());
+  for (size_t i = 0; i < m_nms_result.size(); ++i) {
+    int idx = m_nms_result[i];
+    m_boxes[idx] = m_boxes[idx] & cv::Rect(0, 0, m_image.cols, m_image.rows);
+    YOLO_RESULT &result = m_result[i];
+    result.class_idx = class_ids[idx];
+    result.confidence = confidences[idx];
+    result.bbox = m_boxes[idx];
+    result.obb = cv::RotatedRect();
+    result.mask.release();
+    result.angle = 0;
+    result.track_id = -1;
+    KEYPOINTS &keypoints = result.keypoints;
+    keypoints.clear();
+    int p = m_decoder.m_indices[idx];
+    for (int k = 0; k < kpt_num; ++k) {
+      int f = kpt_offset + k * kpt_dim;
+      if (kpt_dim < 3 || m_decoder.at(f + 2, p) > m_info->confidence_threshold) {
+        keypoints.push_back(Utils::ScalePoint(m_input, m_image.size(), {m_decoder.at(f, p), m_decoder.at(f + 1, p)}));
+      } else {
+        keypoints.push_back({-1, -1});
+      }
+    }
   }
-  m_result = output;
   return m_result;
 }
 
@@ -122,7 +109,10 @@ cv::Mat InferencePose::draw() {
     cv::rectangle(m_image, scaled_bbox, Utils::Color(res.class_idx), 2);
 
     // handle label
-    std::string label = cv::format("%s %.2f", m_info.class_names[res.class_idx].c_str(), res.confidence);
+    std::string label = cv::format("%s %.2f", m_info->class_names[res.class_idx].c_str(), res.confidence);
+    if (res.track_id >= 0) {
+      label = cv::format("#%d ", res.track_id) + label;
+    }
     cv::Size text_size = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.6, 2, nullptr);
     cv::Rect rect_to_fill(left - 1, top - text_size.height - 5, text_size.width + 2, text_size.height + 5);
     cv::Scalar text_color = cv::Scalar(255.0, 255.0, 255.0);
@@ -158,42 +148,36 @@ cv::Mat InferencePose::draw() {
   return m_image;
 }
 
-std::string InferencePose::str() {
-  std::stringstream ss;
-  ss << "{";
-  ss << "\"pose\":[";
-
-  for (size_t i = 0; i < m_result.size(); ++i) {
-    const auto &res = m_result[i];
-    ss << "{";
-    ss << "\"" << m_info.class_names[res.class_idx] << "\":{";
-    ss << "\"confidence\":" << res.confidence << ",";
-    ss << "\"x\":" << res.bbox.x << ",";
-    ss << "\"y\":" << res.bbox.y << ",";
-    ss << "\"w\":" << res.bbox.width << ",";
-    ss << "\"h\":" << res.bbox.height << ",";
-    ss << "\"keypoints\":{";
+void InferencePose::write(std::string &out) {
+  JsonWriter json(out);
+  json.beginObject().key("pose").beginArray();
+  for (const auto &res : m_result) {
+    json.beginObject().key(m_info->class_names[res.class_idx]).beginObject();
+    json.key("confidence").value(res.confidence);
+    if (res.track_id >= 0) {
+      json.key("track_id").value(res.track_id);
+    }
+    json.key("x").value(res.bbox.x);
+    json.key("y").value(res.bbox.y);
+    json.key("w").value(res.bbox.width);
+    json.key("h").value(res.bbox.height);
+    // visible keypoints only, keyed by their index
+    json.key("keypoints").beginObject();
     for (int j = 0; j < res.keypoints.size(); ++j) {
       const auto &pt = res.keypoints.at(j);
       if (pt.x < 0 || pt.y < 0) {
         continue;
       }
-      ss << "\"" << j << "\":";
-      ss << "{" << "\"x\":" << pt.x << "," << "\"y\":" << pt.y << "}";
-      if (j != res.keypoints.size() - 1) {
-        ss << ",";
-      }
-    }
-    ss << "}";
-    ss << "}}";
-    if (i != m_result.size() - 1) {
-      ss << ",";
+      char name[12];
+      auto end = std::to_chars(name, name + sizeof(name), j).ptr;
+      json.key(std::string_view(name, end - name)).beginObject();
+      json.key("x").value(pt.x).key("y").value(pt.y);
+      json.endObject();
     }
+    json.endObject();
+    json.endObject().endObject();
   }
-
-  ss << "]";
-  ss << "}";
-  return ss.str();
+  json.endArray().endObject();
 }
 
 }  // namespace my_yolo
@@ -10,9 +10,9 @@ class InferencePose : public Inference {
 
   // Inference interface
  public:
-  std::vector<YOLO_RESULT> process(const std::vector<cv::Mat> &) override;
+  const std::vector<YOLO_RESULT>& process(const std::vector<cv::Mat> &) override;
   cv::Mat draw() override;
-  std::string str() override;
+  void write(std::string &out) override;
 };
 
 }  // namespace my_yolo
@@ -1,126 +1,164 @@
 #include "inferencesegment.h"
 
+#include "jsonwriter.h"
+#include "maskencoder.h"
 #include "utils.h"
 
 namespace my_yolo {
 
-cv::Mat InferenceSegment::getMask(const cv::Mat &masks_features, const cv::Mat &proto, const cv::Mat &image,
-                                  const cv::Rect bound) {
-  cv::Size img_shape = image.size();
-  cv::Size model_shape = cv::Size(m_info.model_width, m_info.model_height);
-  cv::Size downsampled_size = cv::Size(m_info.mask_width, m_info.mask_height);
-
-  cv::Rect_<float> bound_float(static_cast<float>(bound.x), static_cast<float>(bound.y),
-                               static_cast<float>(bound.width), static_cast<float>(bound.height));
-
-  cv::Rect_<float> downsampled_bbox = Utils::ScaleBox(img_shape, bound_float, downsampled_size);
-  cv::Size bound_size = cv::Size(m_info.mask_width, m_info.mask_height);
-  Utils::ClipBox(downsampled_bbox, bound_size);
-
-  cv::Mat matmul_res = (masks_features * proto).t();
-  matmul_res = matmul_res.reshape(1, {downsampled_size.height, downsampled_size.width});
-  // apply sigmoid to the mask:
-  cv::Mat sigmoid_mask;
-  exp(-matmul_res, sigmoid_mask);
-  sigmoid_mask = 1.0 / (1.0 + sigmoid_mask);
-  cv::Mat resized_mask;
-  cv::Rect_<float> input_bbox = Utils::ScaleBox(img_shape, bound_float, model_shape);
-  cv::resize(sigmoid_mask, resized_mask, model_shape, 0, 0, cv::INTER_LANCZOS4);
-  cv::Mat pre_out_mask = resized_mask(input_bbox);
-  cv::Mat scaled_mask;
-  Utils::ScaleImage(scaled_mask, resized_mask, img_shape);
-  cv::Mat mask_out;
-  cv::resize(scaled_mask, mask_out, img_shape);
-  mask_out = mask_out(bound) > m_info.mask_threshold;
-  return mask_out;
+cv::Mat InferenceSegment::view(cv::Mat &buffer, const cv::Size &size, const int &type) {
+  if (buffer.u && buffer.u->refcount > 1) {
+    buffer.release();
+  }
+  int area = std::max(1, size.area());
+  if (buffer.type() != type || buffer.cols < area) {
+    buffer.create(1, std::max(area, buffer.type() == type ? buffer.cols : 0), type);
+  }
+  // one continuous row reshaped to the box, without a header of its own to allocate
+  return buffer.colRange(0, size.area()).reshape(0, size.height);
+}
+
+void InferenceSegment::getMask(const cv::Mat &logits, const cv::Rect &bound, cv::Mat &mask) {
+  // letterbox of the image in the model input, then model input to proto resolution
+  float gain = std::min(m_input.width / (float)m_image.cols, m_input.height / (float)m_image.rows);
+  float pad_x = (m_input.width - m_image.cols * gain) / 2.0f;
+  float pad_y = (m_input.height - m_image.rows * gain) / 2.0f;
+  float sx = gain * m_mask.width / m_input.width;
+  float sy = gain * m_mask.height / m_input.height;
+  float ox = pad_x * m_mask.width / m_input.width;
+  float oy = pad_y * m_mask.height / m_input.height;
+
+  // the box at proto resolution, one pixel larger on each side for bilinear sampling at its border
+  cv::Rect crop(cvFloor(bound.x * sx + ox) - 1, cvFloor(bound.y * sy + oy) - 1, 0, 0);
+  crop.width = cvCeil(bound.br().x * sx + ox) + 1 - crop.x;
+  crop.height = cvCeil(bound.br().y * sy + oy) + 1 - crop.y;
+  crop &= cv::Rect(0, 0, logits.cols, logits.rows);
+  if (crop.empty()) {
+    mask.setTo(0);
+    return;
+  }
+
+  // sigmoid of the crop only
+  cv::Mat sigmoid = view(m_crop, crop.size(), CV_32F);
+  logits(crop).convertTo(sigmoid, CV_32F, -1.0);
+  cv::exp(sigmoid, sigmoid);
+  // in place, cv::add with a scalar takes a heap buffer
+  sigmoid.convertTo(sigmoid, CV_32F, 1.0, 1.0);
+  cv::divide(1.0, sigmoid, sigmoid);
+
+  // box pixel (u, v) samples the crop at the proto position of its center
+  cv::Matx23f map(sx, 0, (bound.x + 0.5f) * sx + ox - 0.5f - crop.x, 0, sy, (bound.y + 0.5f) * sy + oy - 0.5f - crop.y);
+  cv::Mat upsampled = view(m_upsampled, bound.size(), CV_32F);
+  cv::warpAffine(sigmoid, upsampled, map, bound.size(), cv::INTER_LINEAR | cv::WARP_INVERSE_MAP,
+                 cv::BORDER_REPLICATE);
+  cv::compare(upsampled, m_info->mask_threshold, mask, cv::CMP_GT);
 }
 
-std::vector<YOLO_RESULT> InferenceSegment::process(const std::vector<cv::Mat> &outputs) {
+const std::vector<YOLO_RESULT> &InferenceSegment::process(const std::vector<cv::Mat> &outputs) {
   cv::Mat output_boxes, output_masks;
   output_boxes = outputs[0];
-  output_masks = outputs[1];
-  std::vector<int64_t> box_shape = {output_boxes.size[0], output_boxes.size[1],
-                                    output_boxes.size[2]};  // [bs, features, preds_num]
-  cv::Mat output_box = output_boxes.reshape(1, box_shape[1]).t();
   if (outputs.size() > 1) {
+    output_masks = outputs[1];
     auto mask_shape = output_masks.size;
-    m_info.mask_features = mask_shape[1];
-    m_info.mask_height = mask_shape[2];
-    m_info.mask_width = mask_shape[3];
+    m_mask_features = mask_shape[1];
+    m_mask.height = mask_shape[2];
+    m_mask.width = mask_shape[3];
   }
+  // [bs, features, preds_num], features: x, y, w, h, class scores, mask coefficients
+  m_decoder.run(output_boxes, 4, m_info->nc, m_info->confidence_threshold);
+
+  m_result.clear();
+  m_boxes.clear();
+  m_coeffs.clear();
+  for (int p : m_decoder.m_indices) {
+    for (int j = 0; j < m_mask_features; ++j) {
+      m_coeffs.emplace_back(m_decoder.at(4 + m_info->nc + j, p));
+    }
 
-  std::vector<YOLO_RESULT> output;
-  std::vector<int> class_ids;
-  std::vector<float> confidences;
-  std::vector<cv::Rect> boxes;
-  std::vector<std::vector<float>> masks;
-  // 4 - your default number of rect parameters {x, y, w, h}
-  int data_width = m_info.nc + 4 + m_info.mask_features;
-  int rows = output_box.rows;
-  float *pdata = (float *)output_box.data;
-  for (int r = 0; r < rows; ++r) {
-    cv::Mat scores(1, m_info.nc, CV_32FC1, pdata + 4);
-    cv::Point class_id;
-    double max_conf;
-    minMaxLoc(scores, 0, &max_conf, 0, &class_id);
-    if (max_conf > m_info.confidence_threshold) {
-      masks.emplace_back(std::vector<float>(pdata + 4 + m_info.nc, pdata + data_width));
-      class_ids.emplace_back(class_id.x);
-      confidences.emplace_back(max_conf);
-
-      float out_w = pdata[2];
-      float out_h = pdata[3];
-      float out_left = MAX((pdata[0] - 0.5 * out_w + 0.5), 0);
-      float out_top = MAX((pdata[1] - 0.5 * out_h + 0.5), 0);
-      cv::Rect_<float> bbox = cv::Rect(out_left, out_top, (out_w + 0.5), (out_h + 0.5));
-      cv::Rect_<float> scaled_bbox =
-          Utils::ScaleBox(cv::Size(m_info.model_width, m_info.model_height), bbox, m_image.size());
-      boxes.emplace_back(scaled_bbox);
+    float out_w = m_decoder.at(2, p);
+    float out_h = m_decoder.at(3, p);
+    float out_left = MAX((m_decoder.at(0, p) - 0.5 * out_w + 0.5), 0);
+    float out_top = MAX((m_decoder.at(1, p) - 0.5 * out_h + 0.5), 0);
+    cv::Rect_<float> bbox = cv::Rect(out_left, out_top, (out_w + 0.5), (out_h + 0.5));
+    cv::Rect_<float> scaled_bbox = Utils::ScaleBox(m_input, bbox, m_image.size());
+    m_boxes.emplace_back(scaled_bbox);
+  }
+
+  const std::vector<float> &confidences = m_decoder.m_scores;
+  const std::vector<int> &class_ids = m_decoder.m_classes;
+  m_nms.run(m_boxes, confidences, m_info->agnostic ? nullptr : &class_ids, m_info->confidence_threshold,
+            m_info->nms_threshold, m_nms_result, m_info->max_candidates, m_info->max_det);
+
+  bool masks = !output_masks.empty() && !m_nms_result.empty();
+  if (masks) {
+    // first image of the protos tensor, viewed as [mask_features, mask_h * mask_w]
+    cv::Mat proto(m_mask_features, m_mask.width * m_mask.height, CV_32F, output_masks.ptr<float>());
+    // mask logits of all kept detections in one GEMM
+    m_kept.create((int)m_nms_result.size(), m_mask_features, CV_32F);
+    for (size_t i = 0; i < m_nms_result.size(); ++i) {
+      const float *coeffs = &m_coeffs[m_nms_result[i] * m_mask_features];
+      std::copy(coeffs, coeffs + m_mask_features, m_kept.ptr<float>((int)i));
     }
-    pdata += data_width;  // next pred
+    cv::gemm(m_kept, proto, 1.0, cv::noArray(), 0.0, m_logits);
   }
 
-  std::vector<int> nms_result;
-  cv::dnn::NMSBoxes(boxes, confidences, m_info.confidence_threshold, m_info.nms_threshold, nms_result);
-
-  cv::Mat proto;
-  if (!output_masks.empty()) {
-    // select all of the protos tensor
-    cv::Size downsampled_size = cv::Size(m_info.mask_width, m_info.mask_height);
-    std::vector<cv::Range> roi_rangs = {cv::Range(0, 1), cv::Range::all(), cv::Range(0, downsampled_size.height),
-                                        cv::Range(0, downsampled_size.width)};
-    cv::Mat temp_mask = output_masks(roi_rangs).clone();
-    proto = temp_mask.reshape(0, {m_info.mask_features, downsampled_size.width * downsampled_size.height});
+  if (m_masks.size() < m_nms_result.size()) {
+    m_masks.resize(m_nms_result.size());
   }
+  for (size_t i = 0; i < m_nms_result.size(); ++i) {
+    int idx = m_nms_result[i];
+    m_boxes[idx] = m_boxes[idx] & cv::Rect(0, 0, m_image.cols, m_image.rows);
+    m_result.push_back({class_ids[idx], confidences[idx], m_boxes[idx]});
+    if (masks && !m_boxes[idx].empty()) {
+      YOLO_RESULT &result = m_result.back();
+      result.mask = view(m_masks[i], m_boxes[idx].size(), CV_8U);
+      getMask(m_logits.row((int)i).reshape(1, m_mask.height), m_boxes[idx], result.mask);
+    }
+  }
+  return m_result;
+}
 
-  for (int i = 0; i < nms_result.size(); ++i) {
-    int idx = nms_result[i];
-    boxes[idx] = boxes[idx] & cv::Rect(0, 0, m_image.cols, m_image.rows);
-    YOLO_RESULT result = {class_ids[idx], confidences[idx], boxes[idx]};
-    if (!output_masks.empty()) {
-      result.mask = getMask(cv::Mat(masks[idx]).t(), proto, m_image, boxes[idx]);
+// blends `color` into the pixels of `roi` under `mask`, 60% image and 40% color
+static void blend(cv::Mat roi, const cv::Mat &mask, const cv::Scalar &color) {
+  int cn = roi.channels();
+  int c[4] = {(int)color[0], (int)color[1], (int)color[2], 255};
+  if (cn == 1) {
+    c[0] = (c[0] * 29 + c[1] * 150 + c[2] * 77) >> 8;
+  }
+  for (int y = 0; y < roi.rows; ++y) {
+    uchar *dst = roi.ptr<uchar>(y);
+    const uchar *m = mask.ptr<uchar>(y);
+    for (int x = 0; x < roi.cols; ++x, dst += cn) {
+      if (m[x]) {
+        for (int k = 0; k < std::min(cn, 3); ++k) {
+          dst[k] = (uchar)((dst[k] * 6 + c[k] * 4 + 5) / 10);
+        }
+      }
     }
-    output.emplace_back(result);
   }
-  m_result = output;
-  return output;
 }
 
 cv::Mat InferenceSegment::draw() {
   int thickness = 1;
-  cv::Mat mask = m_image.clone();
+  // masks first, each blended only inside its box, so boxes and labels stay on top
+  if (m_image.depth() == CV_8U) {
+    for (const auto &res : m_result) {
+      cv::Rect roi = res.bbox & cv::Rect(0, 0, m_image.cols, m_image.rows);
+      if (!res.mask.empty() && roi == res.bbox && res.mask.size() == roi.size()) {
+        blend(m_image(roi), res.mask, Utils::Color(res.class_idx));
+      }
+    }
+  }
   for (const auto &res : m_result) {
     float left = res.bbox.x;
     float top = res.bbox.y;
     // Draw bounding box
     cv::rectangle(m_image, res.bbox, Utils::Color(res.class_idx), 2);
-    // Draw mask if available
-    if (res.mask.rows && res.mask.cols > 0) {
-      mask(res.bbox).setTo(Utils::Color(res.class_idx), res.mask);
-      cv::addWeighted(m_image, 0.6, mask, 0.4, 0, m_image);
-    }
     // Create label
-    std::string label = cv::format("%s %.2f", m_info.class_names[res.class_idx].c_str(), res.confidence);
+    std::string label = cv::format("%s %.2f", m_info->class_names[res.class_idx].c_str(), res.confidence);
+    if (res.track_id >= 0) {
+      label = cv::format("#%d ", res.track_id) + label;
+    }
     cv::Size text_size = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.6, 2, nullptr);
     cv::Rect rect_to_fill(left - 1, top - text_size.height - 5, text_size.width + 2, text_size.height + 5);
     cv::Scalar text_color = cv::Scalar(255.0, 255.0, 255.0);
@@ -130,33 +168,26 @@ cv::Mat InferenceSegment::draw() {
   return m_image;
 }
 
-std::string InferenceSegment::str() {
-  std::stringstream ss;
-  ss << "{";
-  ss << "\"segment\":[";
-
-  for (size_t i = 0; i < m_result.size(); ++i) {
-    const auto &res = m_result[i];
-    ss << "{";
-    ss << "\"" << m_info.class_names[res.class_idx] << "\": {";
-    ss << "\"confidence\": " << res.confidence << ",";
-    ss << "\"box\": {";
-    ss << "\"x\": " << res.bbox.x << ",";
-    ss << "\"y\": " << res.bbox.y << ",";
-    ss << "\"w\": " << res.bbox.width << ",";
-    ss << "\"h\": " << res.bbox.height;
-    ss << "},";
-    ss << "\"mask\": \"" << Utils::Img2Base64(res.mask) << "\"";
-    ss << "}}";
-
-    if (i != m_result.size() - 1) {
-      ss << ",";
+void InferenceSegment::write(std::string &out) {
+  JsonWriter json(out);
+  json.beginObject().key("segment").beginArray();
+  for (const auto &res : m_result) {
+    json.beginObject().key(m_info->class_names[res.class_idx]).beginObject();
+    json.key("confidence").value(res.confidence);
+    if (res.track_id >= 0) {
+      json.key("track_id").value(res.track_id);
     }
+    json.key("box").beginObject();
+    json.key("x").value(res.bbox.x);
+    json.key("y").value(res.bbox.y);
+    json.key("w").value(res.bbox.width);
+    json.key("h").value(res.bbox.height);
+    json.endObject();
+    json.key("mask");
+    MaskEncoder::write(json.next(), res.mask, m_info->mask_format, res.bbox.tl(), m_size, m_info->mask_tolerance);
+    json.endObject().endObject();
   }
-
-  ss << "]";
-  ss << "}";
-  return ss.str();
+  json.endArray().endObject();
 }
 
 }  // namespace my_yolo
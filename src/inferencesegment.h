@@ -10,12 +10,29 @@ class InferenceSegment : public Inference {
 
   // Inference interface
  public:
-  std::vector<YOLO_RESULT> process(const std::vector<cv::Mat> &) override;
+  const std::vector<YOLO_RESULT>& process(const std::vector<cv::Mat> &) override;
   cv::Mat draw() override;
-  std::string str() override;
+  void write(std::string &out) override;
 
  private:
-  cv::Mat getMask(const cv::Mat &masks_features, const cv::Mat &proto, const cv::Mat &image, const cv::Rect bound);
+  void getMask(const cv::Mat &logits, const cv::Rect &bound, cv::Mat &mask);
+  // `size` view into `buffer`, which only grows; `buffer` is replaced when a result handed out earlier still
+  // holds it, so a mask kept by the caller is never overwritten
+  static cv::Mat view(cv::Mat &buffer, const cv::Size &size, const int &type);
+
+  // shape of the protos tensor: mask_features maps of m_mask
+  int m_mask_features = 0;
+  cv::Size m_mask;
+  // mask coefficients of the candidates, mask_features floats each
+  std::vector<float> m_coeffs;
+  // coefficients of the kept detections and their mask logits, one row each
+  cv::Mat m_kept;
+  cv::Mat m_logits;
+  // per box scratch: sigmoid of the crop at proto resolution, then upsampled to the box
+  cv::Mat m_crop;
+  cv::Mat m_upsampled;
+  // storage of the masks of m_result, one per result
+  std::vector<cv::Mat> m_masks;
 };
 
 }  // namespace my_yolo
@@ -0,0 +1,168 @@
+#include "jsonwriter.h"
+
+#include <charconv>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace my_yolo {
+
+void JsonWriter::separate() {
+  if (m_after_key) {
+    m_after_key = false;
+    return;
+  }
+  if (m_depth > 0) {
+    if (!m_first[m_depth - 1]) {
+      m_out += ',';
+    }
+    m_first[m_depth - 1] = false;
+  }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+  separate();
+  m_out += '{';
+  if (m_depth < kMaxDepth) {
+    m_first[m_depth] = true;
+  }
+  ++m_depth;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+  --m_depth;
+  m_out += '}';
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+  separate();
+  m_out += '[';
+  if (m_depth < kMaxDepth) {
+    m_first[m_depth] = true;
+  }
+  ++m_depth;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+  --m_depth;
+  m_out += ']';
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(const std::string_view& name) {
+  separate();
+  appendString(m_out, name);
+  m_out += ':';
+  m_after_key = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const std::string_view& text) {
+  separate();
+  appendString(m_out, text);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text) {
+  separate();
+  appendString(m_out, text);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const float& number) {
+  separate();
+  appendFloat(m_out, number);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const int& number) {
+  separate();
+  appendInt(m_out, number);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const bool& flag) {
+  separate();
+  m_out += flag ? "true" : "false";
+  return *this;
+}
+
+std::string& JsonWriter::next() {
+  separate();
+  return m_out;
+}
+
+void JsonWriter::appendInt(std::string& out, const long long& number) {
+  char buf[24];
+  auto res = std::to_chars(buf, buf + sizeof(buf), number);
+  out.append(buf, res.ptr);
+}
+
+void JsonWriter::appendFloat(std::string& out, const float& number) {
+  if (!std::isfinite(number)) {
+    out += "null";
+    return;
+  }
+  char buf[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto res = std::to_chars(buf, buf + sizeof(buf), number);
+  out.append(buf, res.ptr);
+#else
+  // standard libraries without floating point to_chars: the shortest %g that reads back as the same float, 9
+  // digits always do; printf and strtof agree on the locale's decimal point, JSON wants '.'
+  int len = 0;
+  for (int precision = 6; precision <= 9; ++precision) {
+    len = std::snprintf(buf, sizeof(buf), "%.*g", precision, number);
+    if (std::strtof(buf, nullptr) == number) {
+      break;
+    }
+  }
+  char point = std::localeconv()->decimal_point[0];
+  for (int i = 0; i < len; ++i) {
+    if (buf[i] == point) {
+      buf[i] = '.';
+    }
+  }
+  out.append(buf, len);
+#endif
+}
+
+void JsonWriter::appendString(std::string& out, const std::string_view& text) {
+  static const char kHex[] = "0123456789abcdef";
+  out += '"';
+  for (char c : text) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out += "\\u00";
+          out += kHex[(c >> 4) & 0xf];
+          out += kHex[c & 0xf];
+        } else {
+          out += c;
+        }
+        break;
+    }
+  }
+  out += '"';
+}
+
+}  // namespace my_yolo
@@ -0,0 +1,47 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <string>
+#include <string_view>
+
+namespace my_yolo {
+
+// appends JSON to a caller-owned string, reusing its capacity; commas between members and elements are inserted
+// automatically, numbers use the shortest form that reads back to the same value
+class JsonWriter {
+ public:
+  explicit JsonWriter(std::string& out) : m_out(out) {}
+  ~JsonWriter() = default;
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+  JsonWriter& key(const std::string_view& name);
+  JsonWriter& value(const std::string_view& text);
+  JsonWriter& value(const char* text);
+  JsonWriter& value(const float& number);
+  JsonWriter& value(const int& number);
+  JsonWriter& value(const bool& flag);
+  // the buffer, positioned for one value appended to it directly (already serialized masks)
+  std::string& next();
+
+  static void appendInt(std::string& out, const long long& number);
+  // NaN and infinities are written as null
+  static void appendFloat(std::string& out, const float& number);
+  static void appendString(std::string& out, const std::string_view& text);
+
+ private:
+  // comma before every array element and object member but the first
+  void separate();
+
+  static constexpr int kMaxDepth = 32;
+  std::string& m_out;
+  bool m_first[kMaxDepth];
+  int m_depth = 0;
+  bool m_after_key = false;
+};
+
+}  // namespace my_yolo
+
+#endif  // JSONWRITER_H
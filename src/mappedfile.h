@@ -0,0 +1,36 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace my_yolo {
+
+// read-only memory mapping of a whole file
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const std::string& path);
+  void close();
+  // tell the OS the pages are not needed right now, they are read back from the file on next access; a no-op on
+  // Windows, where a file view's pages can only be dropped by unmapping it and are left to working set trimming
+  void release();
+  const char* data() const;
+  size_t size() const;
+
+ private:
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
+
+}  // namespace my_yolo
+
+#endif  // MAPPEDFILE_H
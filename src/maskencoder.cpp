@@ -0,0 +1,157 @@
+#include "maskencoder.h"
+
+#include <vector>
+
+#include "base64.h"
+#include "jsonwriter.h"
+
+namespace my_yolo {
+
+static void size(std::string& out, const cv::Size& size) {
+  out += "\"size\":[";
+  JsonWriter::appendInt(out, size.height);
+  out += ",";
+  JsonWriter::appendInt(out, size.width);
+  out += "]";
+}
+
+void MaskEncoder::write(std::string& out, const cv::Mat& mask, const MASK_FORMAT& format, const cv::Point& origin,
+                        const cv::Size& image, const float& tolerance) {
+  switch (format) {
+    case MASK_FORMAT::RLE:
+      rle(out, mask, origin, image);
+      break;
+    case MASK_FORMAT::POLYGON:
+      polygon(out, mask, origin, tolerance);
+      break;
+    case MASK_FORMAT::BITS:
+      bits(out, mask, origin);
+      break;
+    default:
+      png(out, mask);
+      break;
+  }
+}
+
+void MaskEncoder::rle(std::string& out, const cv::Mat& mask, const cv::Point& origin, const cv::Size& image) {
+  thread_local std::vector<long> counts;
+  counts.clear();
+  // runs in column-major order over the whole image, the first one counts background pixels and may be 0
+  bool inside = false;
+  long run = 0;
+  auto add = [&](const bool& pixel, const long& n) {
+    if (n == 0) {
+      return;
+    }
+    if (pixel != inside) {
+      counts.push_back(run);
+      run = 0;
+      inside = pixel;
+    }
+    run += n;
+  };
+  // the part of the box inside the image, whole background columns and the rows above and below it are one run
+  cv::Rect box = cv::Rect(origin, mask.size()) & cv::Rect(cv::Point(), image);
+  add(false, (long)box.x * image.height);
+  for (int x = 0; x < box.width; ++x) {
+    add(false, box.y);
+    for (int y = 0; y < box.height; ++y) {
+      add(mask.ptr<uchar>(box.y - origin.y + y)[box.x - origin.x + x] != 0, 1);
+    }
+    add(false, image.height - box.br().y);
+  }
+  add(false, (long)(image.width - box.br().x) * image.height);
+  counts.push_back(run);
+
+  out += "{\"format\":\"rle\",";
+  size(out, image);
+  out += ",\"counts\":\"";
+  // rleToString: runs relative to the one two back, 5 bits per character with a continuation bit
+  for (size_t i = 0; i < counts.size(); ++i) {
+    long x = counts[i];
+    if (i > 2) {
+      x -= counts[i - 2];
+    }
+    bool more = true;
+    while (more) {
+      char c = x & 0x1f;
+      x >>= 5;
+      more = (c & 0x10) ? x != -1 : x != 0;
+      if (more) {
+        c |= 0x20;
+      }
+      out += static_cast<char>(c + 48);
+    }
+  }
+  out += "\"}";
+}
+
+void MaskEncoder::polygon(std::string& out, const cv::Mat& mask, const cv::Point& origin, const float& tolerance) {
+  thread_local std::vector<std::vector<cv::Point>> contours;
+  thread_local std::vector<cv::Point> simplified;
+  contours.clear();
+  if (!mask.empty()) {
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+  }
+
+  out += "{\"format\":\"polygon\",\"points\":[";
+  bool first = true;
+  for (const auto& contour : contours) {
+    cv::approxPolyDP(contour, simplified, tolerance, true);
+    if (simplified.size() < 3) {
+      continue;
+    }
+    if (!first) {
+      out += ",";
+    }
+    first = false;
+    out += "[";
+    for (size_t i = 0; i < simplified.size(); ++i) {
+      if (i) {
+        out += ",";
+      }
+      JsonWriter::appendInt(out, simplified[i].x + origin.x);
+      out += ",";
+      JsonWriter::appendInt(out, simplified[i].y + origin.y);
+    }
+    out += "]";
+  }
+  out += "]}";
+}
+
+void MaskEncoder::bits(std::string& out, const cv::Mat& mask, const cv::Point& origin) {
+  thread_local std::vector<unsigned char> packed;
+  size_t total = mask.total();
+  packed.assign((total + 7) / 8, 0);
+  size_t bit = 0;
+  for (int y = 0; y < mask.rows; ++y) {
+    const uchar* row = mask.ptr<uchar>(y);
+    for (int x = 0; x < mask.cols; ++x, ++bit) {
+      if (row[x]) {
+        packed[bit >> 3] |= 0x80 >> (bit & 7);
+      }
+    }
+  }
+
+  out += "{\"format\":\"bits\",\"origin\":[";
+  JsonWriter::appendInt(out, origin.x);
+  out += ",";
+  JsonWriter::appendInt(out, origin.y);
+  out += "],";
+  size(out, mask.size());
+  out += ",\"data\":\"";
+  out += base64_encode(packed.data(), packed.size(), false);
+  out += "\"}";
+}
+
+void MaskEncoder::png(std::string& out, const cv::Mat& mask) {
+  std::vector<uchar> buf;
+  if (!mask.empty()) {
+    cv::imencode(".png", mask, buf);
+  }
+  out += "\"data:image/png;base64,";
+  out += base64_encode(buf.data(), buf.size(), false);
+  out += "\"";
+}
+
+}  // namespace my_yolo
@@ -0,0 +1,35 @@
+#ifndef MASKENCODER_H
+#define MASKENCODER_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#include "definitions.h"
+
+namespace my_yolo {
+
+// serializes an instance mask (8-bit, nonzero = inside, the size of its box) as a JSON value; RLE and polygons are
+// in image coordinates, bits carry the box corner they are placed at and PNG is placed at the result's box
+class MaskEncoder {
+ public:
+  MaskEncoder() = default;
+  ~MaskEncoder() = default;
+
+  // appends the mask in `format`; `origin` is the box corner in the `image` the results refer to
+  static void write(std::string& out, const cv::Mat& mask, const MASK_FORMAT& format, const cv::Point& origin,
+                    const cv::Size& image, const float& tolerance);
+
+  // {"format":"rle","size":[image_h,image_w],"counts":"..."}, the mask placed at `origin` in an otherwise empty
+  // image, column-major runs starting with background compressed into a string as pycocotools does
+  static void rle(std::string& out, const cv::Mat& mask, const cv::Point& origin, const cv::Size& image);
+  // {"format":"polygon","points":[[x0,y0,x1,y1,...],...]}, outer contours simplified by `tolerance`
+  static void polygon(std::string& out, const cv::Mat& mask, const cv::Point& origin, const float& tolerance);
+  // {"format":"bits","origin":[x,y],"size":[h,w],"data":"..."}, the box only
+  static void bits(std::string& out, const cv::Mat& mask, const cv::Point& origin);
+  // "data:image/png;base64,..."
+  static void png(std::string& out, const cv::Mat& mask);
+};
+
+}  // namespace my_yolo
+
+#endif  // MASKENCODER_H
@@ -1,9 +1,6 @@
 #include "metadata.h"
 
-#include <fstream>
-#include <sstream>
 #include <iostream>
-#include <regex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -12,62 +9,93 @@
 
 namespace my_yolo {
 
+// protobuf wire types
+enum WIRE_TYPE { VARINT = 0, FIXED64 = 1, LENGTH_DELIMITED = 2, FIXED32 = 5 };
+// onnx.proto: ModelProto.metadata_props, StringStringEntryProto.key / .value
+constexpr uint64_t MODEL_METADATA_PROPS = 14;
+constexpr uint64_t ENTRY_KEY = 1;
+constexpr uint64_t ENTRY_VALUE = 2;
+
 Metadata::Metadata() {}
 
 Metadata::~Metadata() {}
 
-std::string Metadata::readFileTail(const std::string& file_path, const size_t& tail_size) {
-  std::ifstream file(file_path, std::ios::binary | std::ios::ate);
-  if (!file.is_open()) {
-    std::cerr << "Failed to open the file!" << std::endl;
-    return "";
-  }
-
-  size_t file_size = file.tellg();
-  size_t tail = tail_size;
-  if (file_size < tail_size) {
-    tail = file_size;
-  }
+bool Metadata::parse(const char* data, const size_t& size) {
+  const uint8_t* pos = reinterpret_cast<const uint8_t*>(data);
+  const uint8_t* end = pos + size;
 
-  file.seekg(file_size - tail, std::ios::beg);
-
-  std::string file_tail(tail, '\0');
-  file.read(&file_tail[0], tail);
-  file.close();
+  // walk the top level fields of ModelProto, the graph and everything else is skipped by its length
+  while (pos < end) {
+    uint64_t tag;
+    if (!readVarint(pos, end, tag)) {
+      break;
+    }
+    int wire_type = tag & 0x7;
+    if ((tag >> 3) != MODEL_METADATA_PROPS || wire_type != LENGTH_DELIMITED) {
+      if (!skipField(pos, end, wire_type)) {
+        break;
+      }
+      continue;
+    }
 
-  int loc = file_tail.find("description");
-  if (loc != std::string::npos) {
-    int start = loc - 4;
-    return file_tail.substr(start);
+    uint64_t length;
+    if (!readVarint(pos, end, length) || length > static_cast<uint64_t>(end - pos)) {
+      break;
+    }
+    const uint8_t* entry_end = pos + length;
+    std::string key, value;
+    while (pos < entry_end) {
+      uint64_t entry_tag, entry_length;
+      if (!readVarint(pos, entry_end, entry_tag)) {
+        break;
+      }
+      if ((entry_tag & 0x7) != LENGTH_DELIMITED) {
+        if (!skipField(pos, entry_end, entry_tag & 0x7)) {
+          break;
+        }
+        continue;
+      }
+      if (!readVarint(pos, entry_end, entry_length) || entry_length > static_cast<uint64_t>(entry_end - pos)) {
+        break;
+      }
+      if ((entry_tag >> 3) == ENTRY_KEY) {
+        key.assign(reinterpret_cast<const char*>(pos), entry_length);
+      } else if ((entry_tag >> 3) == ENTRY_VALUE) {
+        value.assign(reinterpret_cast<const char*>(pos), entry_length);
+      }
+      pos += entry_length;
+    }
+    pos = entry_end;
+    if (!key.empty()) {
+      m_data[key] = value;
+    }
   }
 
-  std::cerr << "No Description Found!" << std::endl;
-  std::cerr << "Please set classes and model size manullay!(or increase "
-               "read size and try again)"
-            << std::endl;
-  return "";
-}
-
-void Metadata::analysis(const std::string& data) {
-  int begin = 0;
-
-  for (size_t i = 0; i < v_key.size(); ++i) {
-    m_data[v_key[i]] = extract(begin, data, v_key[i]);
+  if (m_data.empty()) {
+    std::cerr << "No Description Found!" << std::endl;
+    std::cerr << "Please set classes and model size manullay!" << std::endl;
+    return false;
   }
+  analysis();
+  return true;
+}
 
+void Metadata::analysis() {
   // get batch
-  if (!m_data["batch"].empty()) {
-    m_batch = std::stoi(m_data["batch"]);
+  std::vector<int> batch = parseInts(getMetadata("batch"));
+  if (!batch.empty()) {
+    m_batch = batch[0];
   }
 
   // get stride
-  if (!m_data["stride"].empty()) {
-    m_stride = std::stoi(m_data["stride"]);
+  std::vector<int> stride = parseInts(getMetadata("stride"));
+  if (!stride.empty()) {
+    m_stride = stride[0];
   }
 
   // get task
-  if (!m_data["task"].empty()) {
-    std::string task = m_data["task"];
+  std::string task = getMetadata("task");
+  if (!task.empty()) {
     m_task = TASK::UNKNOWN;
     if ("segment" == task) {
       m_task = TASK::SEGMENT;
@@ -82,56 +110,30 @@ void Metadata::analysis(const std::string& data) {
     }
   }
 
-  // get imgsz
-  std::smatch match;
-  if (!m_data["imgsz"].empty()) {
-    std::regex re_imgsz(R"(\[(\d+),\s*(\d+)\])");
-    if (std::regex_match(m_data["imgsz"], match, re_imgsz)) {
-      int height = std::stoi(match[1].str());
-      int width = std::stoi(match[2].str());
-      std::cout << "Height: " << height << ", Width: " << width << std::endl;
-      m_imgsz.w = width;
-      m_imgsz.h = height;
-    } else {
-      std::cout << "Invalid format!" << std::endl;
-    }
+  // get imgsz: [h, w]
+  std::vector<int> imgsz = parseInts(getMetadata("imgsz"));
+  if (imgsz.size() == 2) {
+    std::cout << "Height: " << imgsz[0] << ", Width: " << imgsz[1] << std::endl;
+    m_imgsz.h = imgsz[0];
+    m_imgsz.w = imgsz[1];
+  } else if (!imgsz.empty()) {
+    std::cout << "Invalid format!" << std::endl;
   }
 
   // get names
-  if (!m_data["names"].empty()) {
-    std::string names = m_data["names"];
-    std::vector<std::string> list;
-    // remove '{', '}'
-    names = names.substr(1, names.size() - 2);
-    std::stringstream ss(names);
-    std::string item;
-
-    while (std::getline(ss, item, ',')) {
-      item.erase(std::remove(item.begin(), item.end(), '\''), item.end());
-      item.erase(0, item.find_first_not_of(" "));
-
-      size_t pos = item.find(": ");
-      if (pos != std::string::npos) {
-        item = item.substr(pos + 2);
-      }
-
-      list.push_back(item);
-    }
-    m_names = list;
-  }
-
-  // get keypoints
-  if (!m_data["kpt_shape"].empty()) {
-    std::regex re_kpt(R"(\[(\d+),\s*(\d+)\])");
-    if (std::regex_match(m_data["kpt_shape"], match, re_kpt)) {
-      int nums = std::stoi(match[1].str());
-      int dims = std::stoi(match[2].str());
-      std::cout << "Nums: " << nums << ", Dims: " << dims << std::endl;
-      m_keypoint.num = nums;
-      m_keypoint.dim = dims;
-    } else {
-      std::cout << "Invalid format!" << std::endl;
+  m_names = parseNames(getMetadata("names"));
+
+  // get keypoints: [num, dim]
+  std::vector<int> kpt = parseInts(getMetadata("kpt_shape"));
+  if (kpt.size() == 2) {
+    std::cout << "Nums: " << kpt[0] << ", Dims: " << kpt[1] << std::endl;
+    m_keypoint.num = kpt[0];
+    m_keypoint.dim = kpt[1];
+    if (kpt[0] > KEYPOINTS::kCapacity) {
+      std::cout << "More than " << KEYPOINTS::kCapacity << " keypoints, stored on the heap per result" << std::endl;
     }
+  } else if (!kpt.empty()) {
+    std::cout << "Invalid format!" << std::endl;
   }
 }
 
@@ -147,37 +149,97 @@ IMGSZ Metadata::getImgsz() { return m_imgsz; }
 
 KEYPOINT Metadata::getKeypoint() { return m_keypoint; }
 
-uint32_t Metadata::decodeULEB128(int& jmp, const std::string& data, const int& begin) {
-  uint32_t result = 0;
-  int shift = 0;
-  int pos = begin;
-
-  while (pos < data.size()) {
-    uint8_t byte = static_cast<uint8_t>(data[pos]);
-    pos++;
+bool Metadata::readVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+    uint8_t byte = *pos++;
     // extract the lower 7 bits and merge
-    result |= (byte & 0x7F) << shift;
-    // break if MSB is 0
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    // done if MSB is 0
     if ((byte & 0x80) == 0) {
-      break;
+      return true;
     }
-    shift += 7;
-    jmp += 1;
   }
+  return false;
+}
 
-  return result;
+bool Metadata::skipField(const uint8_t*& pos, const uint8_t* end, const int& wire_type) {
+  uint64_t value;
+  switch (wire_type) {
+    case VARINT:
+      return readVarint(pos, end, value);
+    case FIXED64:
+      value = 8;
+      break;
+    case LENGTH_DELIMITED:
+      if (!readVarint(pos, end, value)) {
+        return false;
+      }
+      break;
+    case FIXED32:
+      value = 4;
+      break;
+    default:
+      return false;
+  }
+  if (value > static_cast<uint64_t>(end - pos)) {
+    return false;
+  }
+  pos += value;
+  return true;
 }
 
-std::string Metadata::extract(int& begin, const std::string& data, const std::string& key) {
-  int JMP = 2;
-  int size = decodeULEB128(JMP, data, begin + 1);
-  if (size) {
-    std::string str = data.substr(begin + JMP, size);
-    std::string val = str.substr(2 + key.size() + JMP);
-    begin += JMP + size;
-    return val;
+// every run of digits in order, "[640, 640]" -> {640, 640}
+std::vector<int> Metadata::parseInts(const std::string& value) {
+  std::vector<int> ints;
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (value[i] < '0' || value[i] > '9') {
+      continue;
+    }
+    int n = 0;
+    while (i < value.size() && value[i] >= '0' && value[i] <= '9') {
+      n = n * 10 + (value[i++] - '0');
+    }
+    ints.push_back(n);
   }
-  return "";
+  return ints;
+}
+
+// python dict repr, "{0: 'person', 1: \"people's\"}" -> {"person", "people's"}
+std::vector<std::string> Metadata::parseNames(const std::string& value) {
+  std::vector<std::string> names;
+  size_t i = 0;
+  while (i < value.size()) {
+    // key
+    while (i < value.size() && (value[i] < '0' || value[i] > '9')) {
+      ++i;
+    }
+    size_t idx = 0;
+    while (i < value.size() && value[i] >= '0' && value[i] <= '9') {
+      idx = idx * 10 + (value[i++] - '0');
+    }
+    // quoted value
+    while (i < value.size() && value[i] != '\'' && value[i] != '"') {
+      ++i;
+    }
+    if (i >= value.size()) {
+      break;
+    }
+    char quote = value[i++];
+    std::string name;
+    while (i < value.size() && value[i] != quote) {
+      if (value[i] == '\\' && i + 1 < value.size()) {
+        ++i;
+      }
+      name += value[i++];
+    }
+    ++i;
+    if (names.size() <= idx) {
+      names.resize(idx + 1);
+    }
+    names[idx] = name;
+  }
+  return names;
 }
 
 std::string Metadata::getMetadata(const std::string& key) {
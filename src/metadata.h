@@ -14,8 +14,8 @@ class Metadata {
  public:
   Metadata();
   ~Metadata();
-  std::string readFileTail(const std::string &file_path, const size_t &tail_size = 2048);
-  void analysis(const std::string &data = "");
+  // reads metadata_props straight from the serialized ONNX ModelProto, false if the model has none
+  bool parse(const char *data, const size_t &size);
 
  public:
   int getBatch();
@@ -26,20 +26,21 @@ class Metadata {
   KEYPOINT getKeypoint();
 
  private:
-  uint32_t decodeULEB128(int &jmp, const std::string &data, const int &begin);
-  std::string extract(int &begin, const std::string &data, const std::string &key);
-
+  void analysis();
   std::string getMetadata(const std::string &key);
 
+  static bool readVarint(const uint8_t *&pos, const uint8_t *end, uint64_t &value);
+  static bool skipField(const uint8_t *&pos, const uint8_t *end, const int &wire_type);
+  static std::vector<int> parseInts(const std::string &value);
+  static std::vector<std::string> parseNames(const std::string &value);
+
  private:
-  std::vector<std::string> v_key{"description", "author", "date",  "version", "license", "docs",     "stride",
-                                 "task",        "batch",  "imgsz", "names",   "args",    "kpt_shape"};
   std::unordered_map<std::string, std::string> m_data;
-  int m_batch;
-  int m_stride;
-  TASK m_task;
-  IMGSZ m_imgsz;
-  KEYPOINT m_keypoint;
+  int m_batch = 1;
+  int m_stride = 32;
+  TASK m_task = TASK::UNKNOWN;
+  IMGSZ m_imgsz = {640, 640};
+  KEYPOINT m_keypoint = {0, 0};
   std::vector<std::string> m_names;
 };
 }  // namespace my_yolo
@@ -0,0 +1,100 @@
+#include "modelregistry.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+namespace my_yolo {
+
+std::string ModelRegistry::key(const std::string& path) {
+  std::error_code ec;
+  std::filesystem::path canonical = std::filesystem::canonical(path, ec);
+  if (ec) {
+    return "";
+  }
+  auto size = std::filesystem::file_size(canonical, ec);
+  if (ec) {
+    return "";
+  }
+  auto mtime = std::filesystem::last_write_time(canonical, ec);
+  if (ec) {
+    return "";
+  }
+  return canonical.string() + "|" + std::to_string(size) + "|" +
+         std::to_string(mtime.time_since_epoch().count());
+}
+
+std::shared_ptr<Model> ModelRegistry::get(const std::string& key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(key);
+  if (it == m_index.end()) {
+    return nullptr;
+  }
+  m_lru.splice(m_lru.begin(), m_lru, it->second);
+  return it->second->model;
+}
+
+void ModelRegistry::put(const std::string& key, const std::shared_ptr<Model>& model) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(key);
+  if (it != m_index.end()) {
+    m_used -= it->second->bytes;
+    m_lru.erase(it->second);
+  }
+  m_lru.push_front({key, model, footprint(*model)});
+  m_index[key] = m_lru.begin();
+  m_used += m_lru.front().bytes;
+  evict();
+}
+
+void ModelRegistry::erase(const std::string& key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_index.find(key);
+  if (it == m_index.end()) {
+    return;
+  }
+  m_used -= it->second->bytes;
+  m_lru.erase(it->second);
+  m_index.erase(it);
+}
+
+void ModelRegistry::pin(const std::shared_ptr<Model>& model) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pinned = model;
+  evict();
+}
+
+void ModelRegistry::setBudget(const size_t& bytes) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_budget = bytes;
+  evict();
+}
+
+size_t ModelRegistry::used() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_used;
+}
+
+size_t ModelRegistry::footprint(const Model& model) {
+  // roughly one copy of the weights per replica, the mapping itself is backed by the file
+  size_t replicas = model.pool ? model.pool->size() : 0;
+  return model.file->size() * replicas;
+}
+
+void ModelRegistry::evict() {
+  // the most recently used and the pinned model always stay, requests holding an evicted model keep it alive
+  // until they finish
+  auto it = m_lru.end();
+  while (m_budget && m_used > m_budget && it != m_lru.begin()) {
+    --it;
+    if (it == m_lru.begin() || it->model == m_pinned) {
+      continue;
+    }
+    std::cout << "Evict model: " << it->model->path << std::endl;
+    m_used -= it->bytes;
+    m_index.erase(it->key);
+    it = m_lru.erase(it);
+  }
+}
+
+}  // namespace my_yolo
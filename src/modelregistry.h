@@ -0,0 +1,74 @@
+#ifndef MODELREGISTRY_H
+#define MODELREGISTRY_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "definitions.h"
+#include "inferencefactory.h"
+#include "mappedfile.h"
+#include "netpool.h"
+
+namespace my_yolo {
+
+// a parsed model kept resident: metadata, the mapped ONNX file (to build more replicas) and the replicas
+struct Model {
+  std::string path;
+  // registry key of the file when it was loaded, info and replicas all come from the contents it names
+  std::string key;
+  MODEL_INFO info;
+  std::shared_ptr<MappedFile> file;
+  std::shared_ptr<NetPool> pool;
+  // post-processors, reused across requests
+  std::shared_ptr<InferenceFactory> factory;
+  // info merged with the engine settings it was built from, rebuilt only once those settings change; guarded by
+  // the engine's mutex
+  std::shared_ptr<const MODEL_INFO> merged;
+  std::shared_ptr<const MODEL_INFO> merged_settings;
+  double load_ms = 0;
+  size_t peak_rss_kb = 0;
+};
+
+// loaded models keyed by file identity, least recently used ones are dropped once over budget
+class ModelRegistry {
+ public:
+  ModelRegistry() = default;
+  ~ModelRegistry() = default;
+
+  // canonical path plus size and modification time, empty if the file does not exist
+  static std::string key(const std::string& path);
+
+  std::shared_ptr<Model> get(const std::string& key);
+  void put(const std::string& key, const std::shared_ptr<Model>& model);
+  void erase(const std::string& key);
+  // the engine's active model is never evicted and stays counted against the budget
+  void pin(const std::shared_ptr<Model>& model);
+  // 0 means unlimited
+  void setBudget(const size_t& bytes);
+  size_t used();
+
+ private:
+  static size_t footprint(const Model& model);
+  void evict();
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<Model> model;
+    size_t bytes;
+  };
+  std::list<Entry> m_lru;
+  std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+  std::shared_ptr<Model> m_pinned;
+  size_t m_budget = 0;
+  size_t m_used = 0;
+  std::mutex m_mutex;
+};
+
+}  // namespace my_yolo
+
+#endif  // MODELREGISTRY_H
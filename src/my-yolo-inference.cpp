@@ -1,31 +1,72 @@
 #include "my-yolo-inference.h"
 
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iterator>
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/cuda.hpp>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_map>
+#include <thread>
 #include <vector>
 
 #include "definitions.h"
 #include "inference.h"
 #include "inferencefactory.h"
+#include "imagedecoder.h"
+#include "jsonwriter.h"
+#include "mappedfile.h"
 #include "metadata.h"
+#include "modelregistry.h"
+#include "netpool.h"
+#include "preprocessor.h"
+#include "resultblock.h"
+#include "streampipeline.h"
+#include "tiler.h"
+#include "tracker.h"
+#include "utils.h"
+#include "workerpool.h"
 
 namespace my_yolo {
 
 class MyYoloInference::Impl {
  private:
-  MODEL_INFO m_info;
-  cv::dnn::Net m_net;
-  std::unordered_map<const char*, bool> m_model_loaded;
+  // what one request runs on, taken at its start so loadModel and the setters never change it midway
+  struct Snapshot {
+    std::shared_ptr<const MODEL_INFO> info;
+    std::shared_ptr<NetPool> pool;
+    std::shared_ptr<InferenceFactory> factory;
+  };
+
+ private:
+  // m_info and the model's pool are replaced as a whole and never modified in place, so a request
+  // keeps working on the snapshot it started with while setters and loadModel run
+  std::shared_ptr<const MODEL_INFO> m_info = std::make_shared<MODEL_INFO>();
+  std::shared_ptr<Model> m_model;
+  std::mutex m_mutex;
+  ModelRegistry m_registry;
   bool m_enableCUDA = false;
+  // read by requests loading models while setReplicas writes it
+  std::atomic<int> m_replicas{1};
+  // declared last so pending async requests finish before the members above are destroyed
+  std::shared_ptr<WorkerPool> m_workers;
 
  public:
   Impl() {}
 
-  virtual ~Impl() { m_net = cv::dnn::Net(); }
+  virtual ~Impl() {
+    std::shared_ptr<WorkerPool> workers;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      workers.swap(m_workers);
+    }
+  }
 
   bool enableCUDA() {
     if(cv::cuda::getCudaEnabledDeviceCount() > 0) {
@@ -34,79 +75,79 @@ class MyYoloInference::Impl {
     return m_enableCUDA;
   }
 
-  bool loadModel(const char* path, const int& metadata_size = 2048) {
-    if (m_model_loaded[path]) {
-      return true;
-    }
-    Metadata metadata;
-    std::string data = metadata.readFileTail(path, metadata_size);
-    if (data.empty()) {
-      std::cerr << "no description found!" << std::endl;
+  bool loadModel(const char* path) {
+    std::shared_ptr<Model> model = getModel(path);
+    if (!model) {
       return false;
     }
-    metadata.analysis(data);
-    m_info.class_names = metadata.getNames();
-    m_info.nc = m_info.class_names.size();
-    m_info.model_height = metadata.getImgsz().h;
-    m_info.model_width = metadata.getImgsz().w;
-    m_info.task = metadata.getTask();
-    m_info.kpt = metadata.getKeypoint();
-
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
-      std::cerr << "Failed to load model: " << path << std::endl;
-      return false;
-    }
-
-    file.seekg(0, std::ios::end);
-    size_t model_data_length = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<char> model_data(model_data_length);
-    file.read(model_data.data(), model_data_length);
-    file.close();
+    activate(model);
+    return true;
+  }
 
-    m_net = cv::dnn::readNetFromONNX(model_data.data(), model_data_length);
+  void activate(const std::shared_ptr<Model>& model) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_model = model;
+    m_info = std::make_shared<MODEL_INFO>(withModel(*m_info, *model));
+    // an active model dropped from the registry would still be resident but no longer counted
+    m_registry.pin(model);
+  }
 
-    if (m_net.empty()) {
-      return false;
+  bool setReplicas(const int& replicas) {
+    m_replicas = std::max(1, replicas);
+    std::shared_ptr<Model> model;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      model = m_model;
     }
-    if(m_enableCUDA) {
-      m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
-      m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
-      m_net.enableFusion(false);
+    if (model) {
+      std::shared_ptr<Model> current = ensureReplicas(model);
+      if (!current) {
+        return false;
+      }
+      // the active model's file changed on disk and was loaded again
+      if (current != model) {
+        activate(current);
+      }
     }
-    else {
-      m_net.setPreferableBackend(cv::dnn::DNN_BACKEND_DEFAULT);
-      m_net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
-    }
-    m_model_loaded[path] = true;
+    std::cout << "Network replicas set to: " << m_replicas << std::endl;
     return true;
   }
 
-  void getModelInfo(char* out_json, unsigned int* out_json_size) {
-    std::stringstream ss;
-
-    ss << "{";
-
-    ss << "\"confidence_threshold\":" << m_info.confidence_threshold << ",";
-    ss << "\"nms_threshold\":" << m_info.nms_threshold << ",";
-    ss << "\"mask_threshold\":" << m_info.mask_threshold << ",";
+  void setMemoryBudget(const size_t& bytes) {
+    m_registry.setBudget(bytes);
+    std::cout << "Model memory budget set to: " << bytes << " bytes" << std::endl;
+  }
 
-    ss << "\"class_names\":[";
-    for (size_t i = 0; i < m_info.class_names.size(); ++i) {
-      ss << "\"" << m_info.class_names[i] << "\"";
-      if (i != m_info.class_names.size() - 1)
-        ss << ",";
+  void getModelInfo(char* out_json, unsigned int* out_json_size) {
+    std::shared_ptr<const MODEL_INFO> info;
+    std::shared_ptr<Model> model;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      info = m_info;
+      model = m_model;
+    }
+    std::string& json = buffer();
+    json.clear();
+    JsonWriter writer(json);
+    writer.beginObject();
+    writer.key("confidence_threshold").value(info->confidence_threshold);
+    writer.key("nms_threshold").value(info->nms_threshold);
+    writer.key("mask_threshold").value(info->mask_threshold);
+    writer.key("class_names").beginArray();
+    for (const auto& name : info->class_names) {
+      writer.value(name);
+    }
+    writer.endArray();
+    writer.key("nc").value(info->nc);
+    writer.key("model_width").value(info->model_width);
+    writer.key("model_height").value(info->model_height);
+    if (model) {
+      writer.key("load_ms").value((float)model->load_ms);
+      writer.key("peak_rss_kb").value((int)model->peak_rss_kb);
     }
-    ss << "],";
-
-    ss << "\"nc\":" << m_info.nc << ",";
-    ss << "\"model_width\":" << m_info.model_width << ",";
-    ss << "\"model_height\":" << m_info.model_height << ",";
 
-    std::string task_str;
-    switch (m_info.task) {
+    const char* task_str = "unknown";
+    switch (info->task) {
       case TASK::UNKNOWN:  task_str = "unknown"; break;
       case TASK::DETECT:   task_str = "detect"; break;
       case TASK::SEGMENT:  task_str = "segment"; break;
@@ -114,16 +155,10 @@ class MyYoloInference::Impl {
       case TASK::POSE:     task_str = "pose"; break;
       case TASK::OBB:      task_str = "obb"; break;
     }
-    ss << "\"task\":\"" << task_str << "\"";
-    ss << "}";
+    writer.key("task").value(task_str);
+    writer.endObject();
 
-    std::string json = ss.str();
-
-    if (out_json)
-      memcpy(out_json, json.c_str(), json.size());
-
-    if (out_json_size)
-      *out_json_size = json.size();
+    output(json, out_json, out_json_size);
   }
 
   bool inference(const char* input_path, const char* output_path) {
@@ -134,161 +169,954 @@ class MyYoloInference::Impl {
       return false;
     }
 
-    // 2. preprocess
-    cv::Mat blob = preprocess(image);
-    m_net.setInput(blob);
+    // 2. preprocess, inference, postprocess
+    Snapshot snap = snapshot();
+    InferenceFactory::Handle fc = run(image, snap);
+    if (!fc || fc->m_result.empty()) {
+      std::cerr << "Failed to run Interface!" << std::endl;
+      return false;
+    }
 
-    // 3. opencv inference
-    std::vector<cv::Mat> outputs;
-    try {
-      m_net.forward(outputs, m_net.getUnconnectedOutLayersNames());
-    } catch (const cv::Exception& e) {
-      std::cerr << e.what() << std::endl;
+    // 3. the drawn image is what this call produces, a window only when asked for
+    fc->draw();
+    if (output_path && output_path[0]) {
+      try {
+        cv::imwrite(output_path, image);
+      } catch (const cv::Exception& e) {
+        std::cerr << e.what() << std::endl;
+      }
     }
+    if (snap.info->render == RENDER_MODE::DISPLAY) {
+      cv::imshow("img", image);
+      cv::waitKey();
+    }
+    return true;
+  }
 
-    // 4. handle outputs
-    std::unique_ptr<Inference> fc = InferenceFactory::Process(image, m_info);
-    std::vector<YOLO_RESULT> results = fc->process(outputs);
+  bool inference(const void* image_data, unsigned int image_size, char* out_json, unsigned int* out_json_size) {
+    std::string& json = buffer();
+    if (!inference(image_data, image_size, json)) {
+      return false;
+    }
+    return output(json, out_json, out_json_size);
+  }
 
-    if (results.empty()) {
-      std::cerr << "Failed to run Interface!" << std::endl;
+  bool inference(const void* image_data, unsigned int image_size, char* out_json, unsigned int capacity,
+                 unsigned int* needed) {
+    std::string& json = buffer();
+    if (!inference(image_data, image_size, json)) {
       return false;
     }
+    return output(json, out_json, capacity, needed);
+  }
 
-    fc->draw();
-    try {
-      cv::imwrite(output_path, image);
-    } catch (const cv::Exception& e) {
-      std::cerr << e.what() << std::endl;
+  bool inference(const void* image_data, unsigned int image_size, const char** out_json,
+                 unsigned int* out_json_size) {
+    std::string& json = buffer();
+    if (!inference(image_data, image_size, json)) {
+      return false;
     }
-    cv::imshow("img", image);
-    cv::waitKey();
+    *out_json = json.c_str();
+    *out_json_size = json.size();
     return true;
   }
 
-  bool inference(const void* image_data, unsigned int image_size, char* out_json, unsigned int* out_json_size) {
-    // 1. decode image
-    std::vector<uint8_t> buf((const uint8_t*)image_data, (const uint8_t*)image_data + image_size);
-    cv::Mat image = cv::imdecode(buf, cv::IMREAD_COLOR);
-    if (image.empty()) {
-      std::cerr << "Failed to decode image from memory!" << std::endl;
+  bool inference(const void* image_data, unsigned int image_size, std::string& json) {
+    // 1. decode image, 2. preprocess, inference, postprocess
+    InferenceFactory::Handle fc = run(image_data, image_size, snapshot());
+    if (!fc || fc->m_result.empty()) {
+      std::cerr << "Inference result is empty!" << std::endl;
       return false;
     }
 
-    // 2. preprocess
-    cv::Mat blob = preprocess(image);
-    m_net.setInput(blob);
+    // 3. get json
+    json.clear();
+    fc->write(json);
+    return true;
+  }
 
-    // 3. opencv inference
-    std::vector<cv::Mat> outputs;
-    try {
-      m_net.forward(outputs, m_net.getUnconnectedOutLayersNames());
-    } catch (const cv::Exception& e) {
-      std::cerr << e.what() << std::endl;
+  // results as a MyYoloResultHeader block, no results is not a failure here
+  bool inferenceResults(const void* image_data, unsigned int image_size, std::vector<unsigned char>& block) {
+    Snapshot snap = snapshot();
+    InferenceFactory::Handle fc = run(image_data, image_size, snap);
+    if (!fc) {
+      return false;
+    }
+    ResultBlock::pack(fc->m_result, snap.info->task, block);
+    return true;
+  }
+
+  // *out_size is the capacity of out on input and the block size on return, nothing is written when it does not fit
+  bool inferenceResults(const void* image_data, unsigned int image_size, void* out, unsigned int* out_size) {
+    std::vector<unsigned char>& block = blockBuffer();
+    if (out_size == nullptr || !inferenceResults(image_data, image_size, block)) {
+      return false;
+    }
+    unsigned int capacity = *out_size;
+    *out_size = block.size();
+    if (out == nullptr || capacity < block.size()) {
       return false;
     }
+    memcpy(out, block.data(), block.size());
+    return true;
+  }
 
-    // 4. postprocess
-    std::unique_ptr<Inference> fc = InferenceFactory::Process(image, m_info);
-    std::vector<YOLO_RESULT> results = fc->process(outputs);
+  bool inferenceResults(const void* image_data, unsigned int image_size, const void** out, unsigned int* out_size) {
+    std::vector<unsigned char>& block = blockBuffer();
+    if (!inferenceResults(image_data, image_size, block)) {
+      return false;
+    }
+    *out = block.data();
+    *out_size = block.size();
+    return true;
+  }
 
-    if (results.empty()) {
+  // class names of the active model one after the other, each terminated by '\0'
+  bool getClassNames(char* out, unsigned int* out_size) {
+    std::shared_ptr<const MODEL_INFO> info;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      info = m_info;
+    }
+    std::string& names = buffer();
+    names.clear();
+    for (const auto& name : info->class_names) {
+      names += name;
+      names += '\0';
+    }
+    if (out_size == nullptr) {
+      return false;
+    }
+    unsigned int capacity = *out_size;
+    *out_size = names.size();
+    if (out == nullptr || capacity < names.size()) {
+      return false;
+    }
+    memcpy(out, names.data(), names.size());
+    return true;
+  }
+
+  bool inference(const char* model_path, const void* image_data, unsigned int image_size, char* out_json,
+                 unsigned int* out_json_size) {
+    Snapshot snap = snapshot(model_path);
+    if (!snap.pool) {
+      return false;
+    }
+
+    // 1. decode image, 2. preprocess, inference, postprocess
+    InferenceFactory::Handle fc = run(image_data, image_size, snap);
+    if (!fc || fc->m_result.empty()) {
       std::cerr << "Inference result is empty!" << std::endl;
       return false;
     }
 
-    // 5. get json
-    auto val = fc->str();
-    *out_json_size = val.size();
-    std::strncpy(out_json, val.c_str(), val.size());
-    out_json[val.size()] = '\0';
+    // 3. get json
+    std::string& json = buffer();
+    json.clear();
+    fc->write(json);
+    return output(json, out_json, out_json_size);
+  }
+
+  std::future<std::string> inferenceAsync(const void* image_data, unsigned int image_size) {
+    auto task = std::make_shared<std::packaged_task<std::string()>>([this, image_data, image_size]() {
+      std::string json;
+      inference(image_data, image_size, json);
+      return json;
+    });
+    std::future<std::string> future = task->get_future();
+    getWorkers()->submit([task]() { (*task)(); });
+    return future;
+  }
+
+  std::future<bool> inferenceAsync(ImageData* img_data) {
+    auto task = std::make_shared<std::packaged_task<bool()>>([this, img_data]() { return inference(img_data); });
+    std::future<bool> future = task->get_future();
+    getWorkers()->submit([task]() { (*task)(); });
+    return future;
+  }
+
+  void inferenceAsync(const void* image_data, unsigned int image_size, InferenceCallback callback, void* user_data) {
+    getWorkers()->submit([this, image_data, image_size, callback, user_data]() {
+      std::string json;
+      bool ok = false;
+      // nothing may escape into the worker loop, the callback hears about it instead
+      try {
+        ok = inference(image_data, image_size, json);
+      } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        json.clear();
+      }
+      if (callback) {
+        callback(ok, json.c_str(), json.size(), user_data);
+      }
+    });
+  }
+
+  bool stream(const char* source, const StreamCallback& callback) {
+    cv::VideoCapture cap;
+    std::string src = source ? source : "";
+    if (!src.empty() && std::all_of(src.begin(), src.end(), ::isdigit)) {
+      cap.open(std::stoi(src));
+    } else {
+      cap.open(src);
+    }
+    if (!cap.isOpened()) {
+      std::cerr << "Failed to open stream: " << src << std::endl;
+      return false;
+    }
+    return stream(
+        [&cap](StreamFrame& frame) { return cap.read(frame.image) && !frame.image.empty(); }, callback);
+  }
+
+  bool stream(const FrameSource& source, const StreamCallback& callback) {
+    return stream(
+        [&source](StreamFrame& frame) {
+          ImageData data{};
+          if (!source(&data) || data.data == nullptr) {
+            return false;
+          }
+          // converted into the recycled slot, so the caller may reuse its buffer right away
+          Preprocessor::toBGR(data, frame.image);
+          return true;
+        },
+        callback);
+  }
+
+  bool stream(const StreamPipeline::Stage& decode, const StreamCallback& callback) {
+    Snapshot snap = snapshot();
+    if (!snap.pool) {
+      std::cerr << "No model loaded!" << std::endl;
+      return false;
+    }
+    const std::shared_ptr<const MODEL_INFO>& info = snap.info;
+
+    // the last stage keeps one post-processor for the whole stream, so once the slots are warmed up frames are
+    // decoded, letterboxed and post-processed into reused buffers; the forward stage leases a replica per frame,
+    // a stream never holds one while it waits for frames and concurrent requests get their turn
+    InferenceFactory::Handle fc;
+    std::string json;
+    int frame_index = 0;
+
+    // with tracking the network only sees every `interval`-th frame; the forward stage decides, so a decaying
+    // track has the next frame it takes detected, only the frames between forward and post-processing late
+    const TRACK_OPTIONS& options = info->track;
+    bool tracking = options.interval > 0 && info->task != TASK::CLASSIFY;
+    Tracker tracker;
+    // written by the forward stage, and by post-processing for the last frame a track was seen decaying on
+    std::atomic<int> last_detect{-options.interval};
+    std::atomic<int> decayed{-options.interval - 1};
+    auto due = [&](const int& index) { return !tracking || index - last_detect >= options.interval; };
+
+    StreamPipeline pipeline;
+    pipeline.run(
+        [&](StreamFrame& frame) {
+          frame.index = frame_index++;
+          return decode(frame);
+        },
+        [&](StreamFrame& frame) {
+          // frames due by the schedule are letterboxed ahead, an early detection catches up in the forward stage
+          frame.prepared = due(frame.index);
+          if (frame.prepared) {
+            preprocess(frame.image, inputSize(&frame.image, 1, *info), frame.blob);
+          }
+          return true;
+        },
+        [&](StreamFrame& frame) {
+          // a track seen decaying since the last detected frame asks for a new one
+          frame.detect = due(frame.index) || decayed >= last_detect;
+          if (!frame.detect) {
+            return true;
+          }
+          last_detect = frame.index;
+          if (!frame.prepared) {
+            preprocess(frame.image, inputSize(&frame.image, 1, *info), frame.blob);
+          }
+          try {
+            NetPool::Lease replica(*snap.pool);
+            replica->net.setInput(frame.blob);
+            replica->net.forward(replica->outputs, replica->output_names);
+            // the net may hand out views of its own buffers, which the next forward overwrites while this
+            // frame is still waiting for post-processing
+            frame.outputs.resize(replica->outputs.size());
+            for (size_t i = 0; i < replica->outputs.size(); ++i) {
+              replica->outputs[i].copyTo(frame.outputs[i]);
+            }
+          } catch (const cv::Exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+          }
+          return true;
+        },
+        [&](StreamFrame& frame) {
+          json.clear();
+          if (frame.ok) {
+            if (!fc) {
+              fc = snap.factory->Process(frame.image, info);
+              // nothing to predict from until the first detection
+              if (fc) {
+                fc->m_result.clear();
+              }
+            }
+            if (fc) {
+              fc->m_image = frame.image;
+              fc->m_size = frame.image.size();
+              if (!frame.detect) {
+                tracker.predict(fc->m_result, frame.image.size());
+              } else {
+                setInputSize(*fc, frame.blob);
+                fc->process(frame.outputs);
+                if (tracking) {
+                  tracker.update(fc->m_result, options, info->task == TASK::OBB, info->agnostic);
+                }
+              }
+              if (tracking && tracker.confidence() < options.min_confidence) {
+                decayed = frame.index;
+              }
+              if (info->render != RENDER_MODE::NONE) {
+                fc->draw();
+              }
+              fc->write(json);
+            }
+          } else {
+            std::cerr << "Failed to inference at frame " << frame.index << std::endl;
+          }
+          ImageData data{frame.image.data, frame.image.cols, frame.image.rows, frame.image.channels()};
+          return callback(frame.index, json, &data);
+        });
     return true;
   }
 
+  void setWorkers(const int& workers, const int& queue_size) {
+    auto pool = std::make_shared<WorkerPool>(workers, queue_size);
+    std::shared_ptr<WorkerPool> previous;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      previous = m_workers;
+      m_workers = pool;
+    }
+    // the previous pool runs its queued requests to the end on a thread of its own, so this returns at once, even
+    // when called from a callback running on one of its workers
+    if (previous) {
+      std::thread([retired = std::move(previous)]() mutable { retired.reset(); }).detach();
+    }
+    std::cout << "Async workers set to: " << workers << ", queue size: " << queue_size << std::endl;
+  }
+
   bool inference(ImageData* img_data) {
-    // 1. decode image
-    if (img_data == nullptr || img_data->data == nullptr) {
-      std::cerr << "Invalid image data!" << std::endl;
+    // 1. wrap image, 2. preprocess, inference, postprocess
+    Snapshot snap = snapshot();
+    InferenceFactory::Handle fc = run(img_data, snap);
+    if (!fc || fc->m_result.empty()) {
+      std::cerr << "Inference result is empty!" << std::endl;
       return false;
     }
 
-    cv::Mat image(img_data->height, img_data->width, CV_8UC3, img_data->data);
+    // 3. overlay straight into the caller's pixels, only when rendering is on
+    if (snap.info->render != RENDER_MODE::NONE) {
+      fc->draw();
+    }
+    return true;
+  }
 
-    // 2. preprocess
-    cv::Mat blob = preprocess(image);
-    m_net.setInput(blob);
+  // results only, the caller's pixels are never written
+  bool inferenceResults(ImageData* img_data, const void** out, unsigned int* out_size) {
+    Snapshot snap = snapshot();
+    InferenceFactory::Handle fc = run(img_data, snap);
+    if (!fc) {
+      return false;
+    }
+    std::vector<unsigned char>& block = blockBuffer();
+    ResultBlock::pack(fc->m_result, snap.info->task, block);
+    *out = block.data();
+    *out_size = block.size();
+    return true;
+  }
 
-    // 3. inference
-    std::vector<cv::Mat> outputs;
-    try {
-      m_net.forward(outputs, m_net.getUnconnectedOutLayersNames());
-    } catch (const cv::Exception& e) {
-      std::cerr << e.what() << std::endl;
+  bool inference(const void** images_data, const unsigned int* images_size, const int& count, char* out_json,
+                 unsigned int* out_json_size) {
+    if (count <= 0 || images_data == nullptr || images_size == nullptr) {
+      std::cerr << "Invalid batch of " << count << " images!" << std::endl;
       return false;
     }
+    Snapshot snap = snapshot();
+
+    // 1. decode images
+    std::vector<cv::Mat> images;
+    std::vector<int> scales(count, 1);
+    std::vector<cv::Size> sizes(count);
+    for (int i = 0; i < count; ++i) {
+      cv::Mat image = decode(images_data[i], images_size[i], *snap.info, scales[i], sizes[i]);
+      if (image.empty()) {
+        std::cerr << "Failed to decode image " << i << " from memory!" << std::endl;
+        return false;
+      }
+      images.emplace_back(image);
+    }
 
-    // 4. postprocess
-    std::unique_ptr<Inference> fc = InferenceFactory::Process(image, m_info);
-    std::vector<YOLO_RESULT> results = fc->process(outputs);
-    if (results.empty()) {
-      std::cerr << "Inference result is empty!" << std::endl;
+    // 2. preprocess, inference, postprocess
+    std::vector<InferenceFactory::Handle> fcs = run(images, snap);
+    if (fcs.empty()) {
+      std::cerr << "Failed to run batch inference!" << std::endl;
+      return false;
+    }
+    for (size_t i = 0; i < fcs.size(); ++i) {
+      fcs[i]->rescale(scales[i], sizes[i]);
+    }
+
+    // 3. get json, one entry per image
+    std::string& json = buffer();
+    json.clear();
+    JsonWriter writer(json);
+    writer.beginArray();
+    for (auto& fc : fcs) {
+      fc->write(writer.next());
+    }
+    writer.endArray();
+    return output(json, out_json, out_json_size);
+  }
+
+  bool inference(ImageData* images_data, const int& count) {
+    if (count <= 0 || images_data == nullptr) {
+      std::cerr << "Invalid batch of " << count << " images!" << std::endl;
+      return false;
+    }
+    // 1. wrap images
+    std::vector<cv::Mat> images;
+    for (int i = 0; i < count; ++i) {
+      if (images_data[i].data == nullptr) {
+        std::cerr << "Invalid image data at " << i << "!" << std::endl;
+        return false;
+      }
+      images.emplace_back(Preprocessor::view(images_data[i]));
+    }
+
+    // 2. preprocess, inference, postprocess
+    Snapshot snap = snapshot();
+    std::vector<InferenceFactory::Handle> fcs = run(images, snap, images_data);
+    if (fcs.empty()) {
+      std::cerr << "Failed to run batch inference!" << std::endl;
       return false;
     }
 
-    // 5. get result
-    cv::Mat res = fc->draw();
-    res.copyTo(cv::Mat(img_data->height, img_data->width, CV_8UC3, img_data->data));
+    // 3. draw results into each image
+    if (snap.info->render != RENDER_MODE::NONE) {
+      for (const auto& fc : fcs) {
+        fc->draw();
+      }
+    }
     return true;
   }
 
   void setModelImgSize(const int& width, const int& height) {
-    m_info.model_width = width;
-    m_info.model_height = height;
+    updateInfo([&](MODEL_INFO& info) {
+      info.model_width = width;
+      info.model_height = height;
+    });
     std::cout << "Model input size set to: " << width << "x" << height << std::endl;
   }
 
   void setNMS(const float& threshold) {
-    m_info.nms_threshold = threshold;
+    updateInfo([&](MODEL_INFO& info) { info.nms_threshold = threshold; });
     std::cout << "NMS threshold set to: " << threshold << std::endl;
   }
 
+  void setNMSOptions(const int& max_candidates, const int& max_det, const bool& agnostic) {
+    updateInfo([&](MODEL_INFO& info) {
+      info.max_candidates = std::max(0, max_candidates);
+      info.max_det = std::max(0, max_det);
+      info.agnostic = agnostic;
+    });
+    std::cout << "NMS options set to: max_candidates " << max_candidates << ", max_det " << max_det
+              << (agnostic ? ", class-agnostic" : ", per class") << std::endl;
+  }
+
+  void setTiling(const int& tile_size, const int& overlap) {
+    updateInfo([&](MODEL_INFO& info) {
+      info.tile_size = std::max(0, tile_size);
+      info.tile_overlap = std::max(0, std::min(overlap, tile_size - 1));
+    });
+    std::cout << "Tiling set to: " << tile_size << ", overlap: " << overlap << std::endl;
+  }
+
+  void setRect(const bool& rect) {
+    updateInfo([&](MODEL_INFO& info) { info.rect = rect; });
+    std::cout << "Rect input set to: " << (rect ? "on" : "off") << std::endl;
+  }
+
+  void setTracking(const int& interval, const float& high_threshold, const int& max_age,
+                   const float& min_confidence) {
+    updateInfo([&](MODEL_INFO& info) {
+      info.track.interval = std::max(0, interval);
+      info.track.high_threshold = high_threshold;
+      info.track.max_age = std::max(0, max_age);
+      info.track.min_confidence = min_confidence;
+    });
+    std::cout << "Tracking set to: every " << interval << " frames, high threshold " << high_threshold
+              << ", max age " << max_age << ", min confidence " << min_confidence << std::endl;
+  }
+
+  void setRender(const RENDER_MODE& mode) {
+    updateInfo([&](MODEL_INFO& info) { info.render = mode; });
+    std::cout << "Render mode set to: " << static_cast<int>(mode) << std::endl;
+  }
+
+  void setMaskFormat(const MASK_FORMAT& format, const float& tolerance) {
+    updateInfo([&](MODEL_INFO& info) {
+      info.mask_format = format;
+      info.mask_tolerance = std::max(0.0f, tolerance);
+    });
+    std::cout << "Mask format set to: " << static_cast<int>(format) << ", tolerance: " << tolerance << std::endl;
+  }
+
   void setConfidence(const float& threshold) {
-    m_info.confidence_threshold = threshold;
+    updateInfo([&](MODEL_INFO& info) { info.confidence_threshold = threshold; });
     std::cout << "Confidence threshold set to: " << threshold << std::endl;
   }
 
   void setClasses(const char** classes, const int& count) {
-    m_info.class_names.clear();
+    std::vector<std::string> class_names;
     for (size_t i = 0; i < count; ++i) {
-      m_info.class_names.emplace_back(classes[i]);
+      class_names.emplace_back(classes[i]);
     }
+    updateInfo([&](MODEL_INFO& info) { info.class_names = class_names; });
 
     std::cout << "Classes set: ";
-    for (const auto& cls : m_info.class_names) {
+    for (const auto& cls : class_names) {
       std::cout << cls << " ";
     }
     std::cout << std::endl;
   }
 
  private:
-  cv::Mat preprocess(const cv::Mat& image) {
-    // cv::Mat img;
-    // cv::cvtColor(image, img, cv::COLOR_RGB2BGR);
+  // JSON of the last request on this thread, borrowed JSON points into it
+  static std::string& buffer() {
+    thread_local std::string json;
+    return json;
+  }
 
-    // cv::Mat preprocessed_img = Utils::Letterbox(img, {m_info.model_width, m_info.model_height});
-    // cv::Mat blob =
-    //     cv::dnn::blobFromImage(preprocessed_img, 1.0 / 255.0, cv::Size(m_info.model_width, m_info.model_height));
+  // binary results of the last request on this thread
+  static std::vector<unsigned char>& blockBuffer() {
+    thread_local std::vector<unsigned char> block;
+    return block;
+  }
 
+  // *out_json_size only returns the JSON length, out_json is assumed to hold the JSON and its terminator
+  static bool output(const std::string& json, char* out_json, unsigned int* out_json_size) {
+    if (out_json_size) {
+      *out_json_size = json.size();
+    }
+    if (out_json == nullptr) {
+      return false;
+    }
+    memcpy(out_json, json.data(), json.size());
+    out_json[json.size()] = '\0';
+    return true;
+  }
+
+  // at most `capacity` bytes, *needed is the JSON length plus its terminator whether it fits or not
+  static bool output(const std::string& json, char* out_json, const unsigned int& capacity, unsigned int* needed) {
+    unsigned int size = json.size() + 1;
+    if (needed) {
+      *needed = size;
+    }
+    if (out_json == nullptr || capacity < size) {
+      return false;
+    }
+    memcpy(out_json, json.data(), size);
+    return true;
+  }
+
+  std::shared_ptr<WorkerPool> getWorkers() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_workers) {
+      int replicas = m_replicas;
+      m_workers = std::make_shared<WorkerPool>(replicas, 2 * replicas);
+    }
+    return m_workers;
+  }
+
+  Snapshot snapshot() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_model) {
+      return {m_info};
+    }
+    return {m_info, m_model->pool, m_model->factory};
+  }
+
+  // run on another resident (or newly loaded) model without switching the active one
+  Snapshot snapshot(const char* model_path) {
+    std::shared_ptr<Model> model = getModel(model_path);
+    if (!model) {
+      return {};
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (model == m_model) {
+      return {m_info, m_model->pool, m_model->factory};
+    }
+    // every setter replaces m_info, so the merge is only redone after a settings change
+    if (model->merged_settings != m_info) {
+      model->merged = std::make_shared<MODEL_INFO>(withModel(*m_info, *model));
+      model->merged_settings = m_info;
+    }
+    return {model->merged, model->pool, model->factory};
+  }
+
+  // engine settings (thresholds) combined with what the model itself describes
+  static MODEL_INFO withModel(const MODEL_INFO& settings, const Model& model) {
+    MODEL_INFO info = model.info;
+    info.confidence_threshold = settings.confidence_threshold;
+    info.nms_threshold = settings.nms_threshold;
+    info.mask_threshold = settings.mask_threshold;
+    info.max_candidates = settings.max_candidates;
+    info.max_det = settings.max_det;
+    info.agnostic = settings.agnostic;
+    info.tile_size = settings.tile_size;
+    info.tile_overlap = settings.tile_overlap;
+    info.rect = settings.rect;
+    info.render = settings.render;
+    info.track = settings.track;
+    info.mask_format = settings.mask_format;
+    info.mask_tolerance = settings.mask_tolerance;
+    return info;
+  }
+
+  std::shared_ptr<Model> getModel(const char* path) {
+    std::string key = ModelRegistry::key(path);
+    if (key.empty()) {
+      std::cerr << "Failed to load model: " << path << std::endl;
+      return nullptr;
+    }
+    std::shared_ptr<Model> model = m_registry.get(key);
+    if (model) {
+      return ensureReplicas(model);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    model = std::make_shared<Model>();
+    model->path = path;
+    model->key = key;
+
+    // metadata and network are both parsed from one read-only mapping, nothing is copied
+    model->file = std::make_shared<MappedFile>();
+    if (!model->file->open(path)) {
+      std::cerr << "Failed to load model: " << path << std::endl;
+      return nullptr;
+    }
+
+    Metadata metadata;
+    if (!metadata.parse(model->file->data(), model->file->size())) {
+      std::cerr << "no description found!" << std::endl;
+      return nullptr;
+    }
+    model->info.class_names = metadata.getNames();
+    model->info.nc = model->info.class_names.size();
+    model->info.model_height = metadata.getImgsz().h;
+    model->info.model_width = metadata.getImgsz().w;
+    model->info.task = metadata.getTask();
+    model->info.kpt = metadata.getKeypoint();
+    model->info.batch = std::max(1, metadata.getBatch());
+    model->info.stride = metadata.getStride();
+
+    model->factory = std::make_shared<InferenceFactory>(model->info.task);
+    model->pool = std::make_shared<NetPool>();
+    if (!model->pool->create(model->file->data(), model->file->size(), m_replicas, m_enableCUDA)) {
+      return nullptr;
+    }
+    model->file->release();
+
+    model->load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    model->peak_rss_kb = Utils::PeakRSS();
+    std::cout << "Model loaded in " << model->load_ms << " ms, peak RSS " << model->peak_rss_kb << " KB" << std::endl;
+
+    m_registry.put(key, model);
+    return model;
+  }
+
+  // the model with as many replicas as setReplicas asked for, nullptr on failure; they are rebuilt from the mapping
+  // only while the file still has the key the model was loaded under, a file rewritten since is loaded again so
+  // that replicas and info never come from different bytes
+  std::shared_ptr<Model> ensureReplicas(const std::shared_ptr<Model>& model) {
+    int replicas = m_replicas;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (model->pool && model->pool->size() == replicas) {
+        return model;
+      }
+    }
+    if (ModelRegistry::key(model->path) != model->key) {
+      std::cout << "Model file changed, reloading: " << model->path << std::endl;
+      m_registry.erase(model->key);
+      return getModel(model->path.c_str());
+    }
+    auto pool = std::make_shared<NetPool>();
+    if (!pool->create(model->file->data(), model->file->size(), replicas, m_enableCUDA)) {
+      return nullptr;
+    }
+    model->file->release();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      model->pool = pool;
+    }
+    // the footprint grows or shrinks with the replicas
+    m_registry.put(model->key, model);
+    return model;
+  }
+
+  // results found on a reduced decode are brought back to full resolution with Inference::rescale
+  static cv::Mat decode(const void* image_data, const unsigned int& image_size, const MODEL_INFO& info, int& scale,
+                        cv::Size& size) {
+    if (image_data == nullptr || image_size == 0) {
+      return cv::Mat();
+    }
+    // tiles need the full resolution, an empty input size turns reduced decoding off
+    cv::Size input = info.tile_size > 0 ? cv::Size() : cv::Size(info.model_width, info.model_height);
+    return ImageDecoder::decode(image_data, image_size, input, scale, size);
+  }
+
+  template <typename F>
+  void updateInfo(F&& update) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto info = std::make_shared<MODEL_INFO>(*m_info);
+    update(*info);
+    m_info = info;
+  }
+
+  InferenceFactory::Handle run(const cv::Mat& image) { return run(image, snapshot()); }
+
+  InferenceFactory::Handle run(const cv::Mat& image, const Snapshot& snap) {
+    if (snap.pool && tiled(image, *snap.info)) {
+      return runTiled(image, snap);
+    }
+    // no container around the one image or its handle, so once warmed up this path does not allocate
+    InferenceFactory::Handle fc;
+    if (!run(&image, 1, snap, &fc)) {
+      return nullptr;
+    }
+    return fc;
+  }
+
+  // decodes an encoded image and runs it, results are brought back to the full resolution
+  InferenceFactory::Handle run(const void* image_data, const unsigned int& image_size, const Snapshot& snap) {
+    int scale = 1;
+    cv::Size size;
+    cv::Mat image = decode(image_data, image_size, *snap.info, scale, size);
+    if (image.empty()) {
+      std::cerr << "Failed to decode image from memory!" << std::endl;
+      return nullptr;
+    }
+    InferenceFactory::Handle fc = run(image, snap);
+    if (fc) {
+      fc->rescale(scale, size);
+    }
+    return fc;
+  }
+
+  // runs caller memory read in place in its own layout, drawing later writes straight into it
+  InferenceFactory::Handle run(ImageData* img_data, const Snapshot& snap) {
+    if (img_data == nullptr || img_data->data == nullptr) {
+      std::cerr << "Invalid image data!" << std::endl;
+      return nullptr;
+    }
+    cv::Mat image = Preprocessor::view(*img_data);
+    // tiles are cut from the view, which only holds the whole picture for the BGR based formats
+    PIXEL_FORMAT format = img_data->format;
+    if (tiled(image, *snap.info) && (format == PIXEL_FORMAT::BGR || format == PIXEL_FORMAT::BGRA ||
+                                     format == PIXEL_FORMAT::GRAY)) {
+      return run(image, snap);
+    }
+    InferenceFactory::Handle fc;
+    if (!run(&image, 1, snap, &fc, img_data)) {
+      return nullptr;
+    }
+    return fc;
+  }
+
+  static bool tiled(const cv::Mat& image, const MODEL_INFO& info) {
+    return info.tile_size > 0 && info.task != TASK::CLASSIFY &&
+           (image.cols > info.tile_size || image.rows > info.tile_size);
+  }
+
+  // the image is covered by overlapping tiles plus one pass over the whole image for objects larger than a
+  // tile; batches of tiles go through the replicas in parallel and the results are merged afterwards
+  InferenceFactory::Handle runTiled(const cv::Mat& image, const Snapshot& snap) {
+    const MODEL_INFO& info = *snap.info;
+    std::vector<cv::Rect> rects = Tiler::tiles(image.size(), info.tile_size, info.tile_overlap);
+    rects.emplace_back(0, 0, image.cols, image.rows);
+
+    int batch = info.batch;
+    int chunks = (rects.size() + batch - 1) / batch;
+    std::vector<std::vector<YOLO_RESULT>> found(rects.size());
+    std::vector<std::vector<bool>> seams(rects.size());
+    std::atomic<bool> ok{true};
+    cv::parallel_for_(
+        cv::Range(0, chunks),
+        [&](const cv::Range& range) {
+          for (int c = range.start; c < range.end; ++c) {
+            size_t first = c * batch;
+            size_t last = std::min(first + batch, rects.size());
+            std::vector<cv::Mat> tiles;
+            for (size_t i = first; i < last; ++i) {
+              tiles.emplace_back(image(rects[i]));
+            }
+            std::vector<InferenceFactory::Handle> fcs = run(tiles, snap, nullptr, batch);
+            if (fcs.size() != tiles.size()) {
+              ok = false;
+              continue;
+            }
+            for (size_t i = first; i < last; ++i) {
+              found[i] = std::move(fcs[i - first]->m_result);
+              Tiler::offset(found[i], rects[i].tl());
+              for (const auto& res : found[i]) {
+                seams[i].push_back(Tiler::seam(res, rects[i], image.size()));
+              }
+            }
+          }
+        },
+        chunks);
+    if (!ok) {
+      return nullptr;
+    }
+
+    InferenceFactory::Handle fc = snap.factory->Process(image, snap.info);
+    if (!fc) {
+      return nullptr;
+    }
+    fc->m_result.clear();
+    std::vector<bool> cut;
+    for (size_t i = 0; i < found.size(); ++i) {
+      std::move(found[i].begin(), found[i].end(), std::back_inserter(fc->m_result));
+      cut.insert(cut.end(), seams[i].begin(), seams[i].end());
+    }
+    Tiler::merge(fc->m_result, cut, info.nms_threshold, info.task == TASK::OBB);
+    return fc;
+  }
+
+  // letterbox all images into one NCHW blob, run a single forward and split the outputs per image
+  std::vector<InferenceFactory::Handle> run(const std::vector<cv::Mat>& images) { return run(images, snapshot()); }
+
+  // with `sources` the blob is filled from the caller's pixels in their own format, `images` are then only the
+  // views results are drawn on; `batch` pads the blob for models exported with a fixed batch size
+  std::vector<InferenceFactory::Handle> run(const std::vector<cv::Mat>& images, const Snapshot& snap,
+                                              const ImageData* sources = nullptr, const int& batch = 1) {
+    std::vector<InferenceFactory::Handle> fcs(images.size());
+    if (!run(images.data(), images.size(), snap, fcs.data(), sources, batch)) {
+      fcs.clear();
+    }
+    return fcs;
+  }
+
+  // the same for `count` images, one handle per image written to `fcs`
+  bool run(const cv::Mat* images, const size_t& count, const Snapshot& snap, InferenceFactory::Handle* fcs,
+           const ImageData* sources = nullptr, const int& batch = 1) {
+    if (count == 0 || images == nullptr) {
+      std::cerr << "No images to run!" << std::endl;
+      return false;
+    }
+    if (!snap.pool) {
+      std::cerr << "No model loaded!" << std::endl;
+      return false;
+    }
+    const std::shared_ptr<const MODEL_INFO>& info = snap.info;
+
+    // blocks until one of the replicas is free
+    NetPool::Lease replica(*snap.pool);
+
+    int batch_size = std::max<int>(count, batch);
+    cv::Size size = inputSize(images, count, *info);
+    if (sources) {
+      for (size_t i = 0; i < count; ++i) {
+        Preprocessor::run(sources[i], replica->blob, size, i, batch_size);
+      }
+    } else if (batch_size == 1) {
+      preprocess(images[0], size, replica->blob);
+    } else {
+      preprocess(images, count, size, replica->blob, batch_size);
+    }
+    replica->net.setInput(replica->blob);
+
+    try {
+      replica->net.forward(replica->outputs, replica->output_names);
+    } catch (const cv::Exception& e) {
+      std::cerr << e.what() << std::endl;
+      if (count > 1) {
+        std::cerr << "Batch of " << count << " rejected, export the model with a dynamic batch size!" << std::endl;
+      }
+      if (info->rect) {
+        std::cerr << "Input of " << size.width << "x" << size.height
+                  << " rejected, rect mode needs a model exported with dynamic shapes!" << std::endl;
+      }
+      return false;
+    }
+
+    if (batch_size > 1 && replica->slices.size() < count) {
+      replica->slices.resize(count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      fcs[i] = snap.factory->Process(images[i], info);
+      if (!fcs[i]) {
+        return false;
+      }
+      setInputSize(*fcs[i], replica->blob);
+      if (batch_size > 1) {
+        Inference::slice(replica->outputs, i, replica->slices[i]);
+        fcs[i]->process(replica->slices[i]);
+      } else {
+        fcs[i]->process(replica->outputs);
+      }
+    }
+    return true;
+  }
+
+  // the blob is written in place, so passing the same one again with an unchanged shape does not allocate
+  // the model input, or in rect mode the smallest stride-aligned one that fits every image's aspect ratio
+  static cv::Size inputSize(const cv::Mat* images, const size_t& count, const MODEL_INFO& info) {
+    cv::Size model(info.model_width, info.model_height);
+    if (!info.rect || info.task == TASK::CLASSIFY) {
+      return model;
+    }
+    cv::Size size;
+    for (size_t i = 0; i < count; ++i) {
+      cv::Size fit = Preprocessor::rectSize(images[i].size(), model, info.stride);
+      size.width = std::max(size.width, fit.width);
+      size.height = std::max(size.height, fit.height);
+    }
+    return size;
+  }
+
+  // post-processors map boxes back through the input the blob was actually letterboxed to
+  static void setInputSize(Inference& fc, const cv::Mat& blob) {
+    fc.m_input = cv::Size(blob.size[3], blob.size[2]);
+  }
+
+  // slots past the images are left as they are when `batch` is larger
+  void preprocess(const cv::Mat* images, const size_t& count, const cv::Size& size, cv::Mat& blob,
+                  const int& batch) {
+    if (std::all_of(images, images + count, Preprocessor::supports)) {
+      for (size_t i = 0; i < count; ++i) {
+        Preprocessor::run(images[i], blob, size, i, batch);
+      }
+      return;
+    }
+    cv::dnn::blobFromImagesWithParams(std::vector<cv::Mat>(images, images + count), blob, blobParams(size));
+  }
+
+  void preprocess(const cv::Mat& image, const cv::Size& size, cv::Mat& blob) {
+    if (Preprocessor::supports(image)) {
+      Preprocessor::run(image, blob, size);
+      return;
+    }
+    cv::dnn::blobFromImageWithParams(image, blob, blobParams(size));
+  }
+
+  static cv::dnn::Image2BlobParams blobParams(const cv::Size& size) {
     cv::dnn::Image2BlobParams params;
     params.scalefactor = cv::Scalar(1.0 / 255.0, 1.0 / 255.0, 1.0 / 255.0);
-    params.size = cv::Size(m_info.model_width, m_info.model_height);
+    params.size = size;
     params.swapRB = true;
     params.datalayout = cv::dnn::DNN_LAYOUT_NCHW;
     params.paddingmode = cv::dnn::ImagePaddingMode::DNN_PMODE_LETTERBOX;
     params.borderValue = cv::Scalar(114, 114, 114);
-
-    cv::Mat blob = cv::dnn::blobFromImageWithParams(image, params);
-    return blob;
+    return params;
   }
 };
 
@@ -305,8 +1133,8 @@ bool MyYoloInference::enableCUDA() {
   return m_impl->enableCUDA();
 }
 
-bool MyYoloInference::loadModel(const char* path, const int& metadata_size) {
-  return m_impl->loadModel(path, metadata_size);
+bool MyYoloInference::loadModel(const char* path, [[maybe_unused]] const int& metadata_size) {
+  return m_impl->loadModel(path);
 }
 
 void MyYoloInference::getModelInfo(char *out_json, unsigned int *out_json_size) {
@@ -322,31 +1150,178 @@ bool MyYoloInference::inference(const void* image_data, unsigned int image_size,
   return m_impl->inference(image_data, image_size, out_json, out_json_size);
 }
 
+bool MyYoloInference::inference(const void* image_data, unsigned int image_size, char* out_json,
+                                unsigned int capacity, unsigned int* needed) {
+  return m_impl->inference(image_data, image_size, out_json, capacity, needed);
+}
+
+bool MyYoloInference::inference(const void* image_data, unsigned int image_size, const char** out_json,
+                                unsigned int* out_json_size) {
+  return m_impl->inference(image_data, image_size, out_json, out_json_size);
+}
+
+bool MyYoloInference::inferenceResults(const void* image_data, unsigned int image_size, void* out,
+                                       unsigned int* out_size) {
+  return m_impl->inferenceResults(image_data, image_size, out, out_size);
+}
+
+bool MyYoloInference::inferenceResults(const void* image_data, unsigned int image_size, const void** out,
+                                       unsigned int* out_size) {
+  return m_impl->inferenceResults(image_data, image_size, out, out_size);
+}
+
+bool MyYoloInference::getClassNames(char* out, unsigned int* out_size) { return m_impl->getClassNames(out, out_size); }
+
 bool MyYoloInference::inference(ImageData* image_data) { return m_impl->inference(image_data); }
 
+bool MyYoloInference::inference(const void** images_data, const unsigned int* images_size, const int& count,
+                                char* out_json, unsigned int* out_json_size) {
+  return m_impl->inference(images_data, images_size, count, out_json, out_json_size);
+}
+
+bool MyYoloInference::inference(ImageData* images_data, const int& count) {
+  return m_impl->inference(images_data, count);
+}
+
+std::future<std::string> MyYoloInference::inferenceAsync(const void* image_data, unsigned int image_size) {
+  return m_impl->inferenceAsync(image_data, image_size);
+}
+
+std::future<bool> MyYoloInference::inferenceAsync(ImageData* image_data) { return m_impl->inferenceAsync(image_data); }
+
+void MyYoloInference::inferenceAsync(const void* image_data, unsigned int image_size, InferenceCallback callback,
+                                     void* user_data) {
+  m_impl->inferenceAsync(image_data, image_size, callback, user_data);
+}
+
+bool MyYoloInference::stream(const char* source, const StreamCallback& callback) {
+  return m_impl->stream(source, callback);
+}
+
+bool MyYoloInference::stream(const FrameSource& source, const StreamCallback& callback) {
+  return m_impl->stream(source, callback);
+}
+
+void MyYoloInference::setWorkers(const int& workers, const int& queue_size) {
+  m_impl->setWorkers(workers, queue_size);
+}
+
+bool MyYoloInference::inference(const char* model_path, const void* image_data, unsigned int image_size,
+                                char* out_json, unsigned int* out_json_size) {
+  return m_impl->inference(model_path, image_data, image_size, out_json, out_json_size);
+}
+
+void MyYoloInference::setMemoryBudget(const size_t& bytes) { m_impl->setMemoryBudget(bytes); }
+
+bool MyYoloInference::setReplicas(const int& replicas) { return m_impl->setReplicas(replicas); }
+
 void MyYoloInference::setModelImgSize(const int& width, const int& height) { m_impl->setModelImgSize(width, height); }
 
 void MyYoloInference::setNMS(const float& threshold) { m_impl->setNMS(threshold); }
 
+void MyYoloInference::setNMSOptions(const int& max_candidates, const int& max_det, const bool& agnostic) {
+  m_impl->setNMSOptions(max_candidates, max_det, agnostic);
+}
+
+void MyYoloInference::setTiling(const int& tile_size, const int& overlap) { m_impl->setTiling(tile_size, overlap); }
+
+void MyYoloInference::setRect(const bool& rect) { m_impl->setRect(rect); }
+
+void MyYoloInference::setRender(const RENDER_MODE& mode) { m_impl->setRender(mode); }
+
+void MyYoloInference::setTracking(const int& interval, const float& high_threshold, const int& max_age,
+                                  const float& min_confidence) {
+  m_impl->setTracking(interval, high_threshold, max_age, min_confidence);
+}
+
+bool MyYoloInference::inferenceResults(ImageData* image_data, const void** out, unsigned int* out_size) {
+  return m_impl->inferenceResults(image_data, out, out_size);
+}
+
+void MyYoloInference::setMaskFormat(const MASK_FORMAT& format, const float& tolerance) {
+  m_impl->setMaskFormat(format, tolerance);
+}
+
 void MyYoloInference::setConfidence(const float& threshold) { m_impl->setConfidence(threshold); }
 
 void MyYoloInference::setClasses(const char** classes, const int& count) { m_impl->setClasses(classes, count); }
 
 }  // namespace my_yolo
 
-bool loadModel(const char* path, int metadata_size) {
-  if (0 == metadata_size) {
-    metadata_size = 2048;
-  }
-  return MY_YOLO.loadModel(path, metadata_size);
+static my_yolo::MyYoloInference* engine(MyYoloHandle handle) {
+  return static_cast<my_yolo::MyYoloInference*>(handle);
 }
 
+bool loadModel(const char* path, int metadata_size) { return engineLoadModel(&MY_YOLO, path, metadata_size); }
+
 bool inference(const char* input_path, const char* output_path) { return MY_YOLO.inference(input_path, output_path); }
 
+bool inference_binary(const void* image_data, unsigned int image_size, char* out_json, unsigned int* out_json_size) {
+  return MY_YOLO.inference(image_data, image_size, out_json, out_json_size);
+}
+
+bool inference_binary_n(const void* image_data, unsigned int image_size, char* out_json, unsigned int capacity,
+                        unsigned int* needed) {
+  return MY_YOLO.inference(image_data, image_size, out_json, capacity, needed);
+}
+
+bool inference_binary_borrow(const void* image_data, unsigned int image_size, const char** out_json,
+                             unsigned int* out_json_size) {
+  return MY_YOLO.inference(image_data, image_size, out_json, out_json_size);
+}
+
+bool inference_results(const void* image_data, unsigned int image_size, void* out, unsigned int* out_size) {
+  return MY_YOLO.inferenceResults(image_data, image_size, out, out_size);
+}
+
+bool inference_results_borrow(const void* image_data, unsigned int image_size, const void** out,
+                              unsigned int* out_size) {
+  return MY_YOLO.inferenceResults(image_data, image_size, out, out_size);
+}
+
+bool getClassNames(char* out, unsigned int* out_size) { return MY_YOLO.getClassNames(out, out_size); }
+
+bool inference_ImageData(my_yolo::ImageData* image_data) { return MY_YOLO.inference(image_data); }
+
+bool inference_batch_binary(const void** images_data, const unsigned int* images_size, int count, char* out_json,
+                            unsigned int* out_json_size) {
+  return MY_YOLO.inference(images_data, images_size, count, out_json, out_json_size);
+}
+
+void inference_async(const void* image_data, unsigned int image_size, InferenceCallback callback, void* user_data) {
+  MY_YOLO.inferenceAsync(image_data, image_size, callback, user_data);
+}
+
+bool inference_batch_ImageData(my_yolo::ImageData* images_data, int count) {
+  return MY_YOLO.inference(images_data, count);
+}
+
 void setModelImgSize(int width, int height) { MY_YOLO.setModelImgSize(width, height); }
 
 void setNMS(float threshold) { MY_YOLO.setNMS(threshold); }
 
+void setNMSOptions(int max_candidates, int max_det, bool agnostic) {
+  MY_YOLO.setNMSOptions(max_candidates, max_det, agnostic);
+}
+
+void setTiling(int tile_size, int overlap) { MY_YOLO.setTiling(tile_size, overlap); }
+
+void setRect(bool rect) { MY_YOLO.setRect(rect); }
+
+void setRender(int mode) { MY_YOLO.setRender(static_cast<my_yolo::RENDER_MODE>(mode)); }
+
+void setTracking(int interval, float high_threshold, int max_age, float min_confidence) {
+  MY_YOLO.setTracking(interval, high_threshold, max_age, min_confidence);
+}
+
+bool inference_ImageData_results(my_yolo::ImageData* image_data, const void** out, unsigned int* out_size) {
+  return MY_YOLO.inferenceResults(image_data, out, out_size);
+}
+
+void setMaskFormat(int format, float tolerance) {
+  MY_YOLO.setMaskFormat(static_cast<my_yolo::MASK_FORMAT>(format), tolerance);
+}
+
 void setConfidence(float threshold) { MY_YOLO.setConfidence(threshold); }
 
 void setClasses(const char** classes, int count) { MY_YOLO.setClasses(classes, count); }
@@ -358,3 +1333,173 @@ bool enableCUDA() {
 void getModelInfo(char *out_json, unsigned int *out_json_size) {
   MY_YOLO.getModelInfo(out_json, out_json_size);
 }
+
+MyYoloHandle createEngine() { return new my_yolo::MyYoloInference(); }
+
+void destroyEngine(MyYoloHandle handle) {
+  if (handle == &MY_YOLO) {
+    return;
+  }
+  delete engine(handle);
+}
+
+bool engineEnableCUDA(MyYoloHandle handle) { return handle && engine(handle)->enableCUDA(); }
+
+bool engineLoadModel(MyYoloHandle handle, const char* path, int metadata_size) {
+  return handle && engine(handle)->loadModel(path, metadata_size);
+}
+
+void engineGetModelInfo(MyYoloHandle handle, char* out_json, unsigned int* out_json_size) {
+  if (handle) {
+    engine(handle)->getModelInfo(out_json, out_json_size);
+  }
+}
+
+bool engineInference(MyYoloHandle handle, const char* input_path, const char* output_path) {
+  return handle && engine(handle)->inference(input_path, output_path);
+}
+
+bool engineInferenceBinary(MyYoloHandle handle, const void* image_data, unsigned int image_size, char* out_json,
+                           unsigned int* out_json_size) {
+  return handle && engine(handle)->inference(image_data, image_size, out_json, out_json_size);
+}
+
+bool engineInferenceBinaryN(MyYoloHandle handle, const void* image_data, unsigned int image_size, char* out_json,
+                            unsigned int capacity, unsigned int* needed) {
+  return handle && engine(handle)->inference(image_data, image_size, out_json, capacity, needed);
+}
+
+bool engineInferenceBinaryBorrow(MyYoloHandle handle, const void* image_data, unsigned int image_size,
+                                 const char** out_json, unsigned int* out_json_size) {
+  return handle && engine(handle)->inference(image_data, image_size, out_json, out_json_size);
+}
+
+bool engineInferenceResults(MyYoloHandle handle, const void* image_data, unsigned int image_size, void* out,
+                            unsigned int* out_size) {
+  return handle && engine(handle)->inferenceResults(image_data, image_size, out, out_size);
+}
+
+bool engineInferenceResultsBorrow(MyYoloHandle handle, const void* image_data, unsigned int image_size,
+                                  const void** out, unsigned int* out_size) {
+  return handle && engine(handle)->inferenceResults(image_data, image_size, out, out_size);
+}
+
+bool engineGetClassNames(MyYoloHandle handle, char* out, unsigned int* out_size) {
+  return handle && engine(handle)->getClassNames(out, out_size);
+}
+
+bool engineInferenceImageData(MyYoloHandle handle, my_yolo::ImageData* image_data) {
+  return handle && engine(handle)->inference(image_data);
+}
+
+bool engineInferenceBatchBinary(MyYoloHandle handle, const void** images_data, const unsigned int* images_size,
+                                int count, char* out_json, unsigned int* out_json_size) {
+  return handle && engine(handle)->inference(images_data, images_size, count, out_json, out_json_size);
+}
+
+bool engineInferenceBatchImageData(MyYoloHandle handle, my_yolo::ImageData* images_data, int count) {
+  return handle && engine(handle)->inference(images_data, count);
+}
+
+bool engineInferenceAsync(MyYoloHandle handle, const void* image_data, unsigned int image_size,
+                          InferenceCallback callback, void* user_data) {
+  if (!handle) {
+    return false;
+  }
+  engine(handle)->inferenceAsync(image_data, image_size, callback, user_data);
+  return true;
+}
+
+bool engineStream(MyYoloHandle handle, const char* source, StreamResultCallback callback, void* user_data) {
+  if (!handle || !callback) {
+    return false;
+  }
+  return engine(handle)->stream(source, [callback, user_data](int frame_index, const std::string& json,
+                                                               my_yolo::ImageData* frame) {
+    return callback(frame_index, json.c_str(), json.size(), frame, user_data);
+  });
+}
+
+void engineSetWorkers(MyYoloHandle handle, int workers, int queue_size) {
+  if (handle) {
+    engine(handle)->setWorkers(workers, queue_size);
+  }
+}
+
+bool engineInferenceWithModel(MyYoloHandle handle, const char* model_path, const void* image_data,
+                              unsigned int image_size, char* out_json, unsigned int* out_json_size) {
+  return handle && engine(handle)->inference(model_path, image_data, image_size, out_json, out_json_size);
+}
+
+void engineSetMemoryBudget(MyYoloHandle handle, unsigned long long bytes) {
+  if (handle) {
+    engine(handle)->setMemoryBudget(bytes);
+  }
+}
+
+bool engineSetReplicas(MyYoloHandle handle, int replicas) { return handle && engine(handle)->setReplicas(replicas); }
+
+void engineSetModelImgSize(MyYoloHandle handle, int width, int height) {
+  if (handle) {
+    engine(handle)->setModelImgSize(width, height);
+  }
+}
+
+void engineSetNMS(MyYoloHandle handle, float threshold) {
+  if (handle) {
+    engine(handle)->setNMS(threshold);
+  }
+}
+
+void engineSetNMSOptions(MyYoloHandle handle, int max_candidates, int max_det, bool agnostic) {
+  if (handle) {
+    engine(handle)->setNMSOptions(max_candidates, max_det, agnostic);
+  }
+}
+
+void engineSetTiling(MyYoloHandle handle, int tile_size, int overlap) {
+  if (handle) {
+    engine(handle)->setTiling(tile_size, overlap);
+  }
+}
+
+void engineSetRect(MyYoloHandle handle, bool rect) {
+  if (handle) {
+    engine(handle)->setRect(rect);
+  }
+}
+
+void engineSetRender(MyYoloHandle handle, int mode) {
+  if (handle) {
+    engine(handle)->setRender(static_cast<my_yolo::RENDER_MODE>(mode));
+  }
+}
+
+void engineSetTracking(MyYoloHandle handle, int interval, float high_threshold, int max_age, float min_confidence) {
+  if (handle) {
+    engine(handle)->setTracking(interval, high_threshold, max_age, min_confidence);
+  }
+}
+
+bool engineInferenceImageDataResults(MyYoloHandle handle, my_yolo::ImageData* image_data, const void** out,
+                                     unsigned int* out_size) {
+  return handle && engine(handle)->inferenceResults(image_data, out, out_size);
+}
+
+void engineSetMaskFormat(MyYoloHandle handle, int format, float tolerance) {
+  if (handle) {
+    engine(handle)->setMaskFormat(static_cast<my_yolo::MASK_FORMAT>(format), tolerance);
+  }
+}
+
+void engineSetConfidence(MyYoloHandle handle, float threshold) {
+  if (handle) {
+    engine(handle)->setConfidence(threshold);
+  }
+}
+
+void engineSetClasses(MyYoloHandle handle, const char** classes, int count) {
+  if (handle) {
+    engine(handle)->setClasses(classes, count);
+  }
+}
@@ -1,26 +1,141 @@
 #ifndef MY_YOLO_INFERENCE_H
 #define MY_YOLO_INFERENCE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <string>
+
 #include "global.h"
 
+extern "C" {
+// completion callback of the async API, json is only valid during the call
+typedef void (*InferenceCallback)(bool ok, const char* json, unsigned int json_size, void* user_data);
+
+// binary results: one block of MyYoloResultHeader, `count` MyYoloResult, the keypoints and the mask runs, every
+// part at its byte offset from the start of the block; fields a task does not produce are 0
+#define MY_YOLO_RESULT_VERSION 1
+
+typedef struct {
+  uint32_t version;  // MY_YOLO_RESULT_VERSION
+  uint32_t size;     // bytes of the whole block
+  int32_t task;      // my_yolo::TASK: 1 detect, 2 segment, 3 classify, 4 pose, 5 obb
+  int32_t count;
+  uint32_t results_offset;    // MyYoloResult[count]
+  uint32_t keypoints_offset;  // MyYoloKeypoint[], referenced by the results
+  uint32_t keypoint_count;
+  uint32_t masks_offset;  // uint32_t runs, referenced by the results
+  uint32_t mask_run_count;
+} MyYoloResultHeader;
+
+typedef struct {
+  int32_t class_id;
+  float score;
+  // axis-aligned box in image pixels
+  float x, y, w, h;
+  // obb: rotated box center, size and angle in degrees
+  float cx, cy, rw, rh, angle;
+  // pose: index of the first keypoint and their number
+  int32_t keypoint_index, keypoint_count;
+  // segment: mask of w x h, row-major runs alternating outside/inside starting with outside (may be 0)
+  int32_t mask_index, mask_run_count;
+} MyYoloResult;
+
+typedef struct {
+  float x, y;  // -1 when below the confidence threshold
+} MyYoloKeypoint;
+}
+
 namespace my_yolo {
 class ImageData;
+enum class MASK_FORMAT;
+enum class RENDER_MODE;
+
+// stream results, called in frame order with the drawn frame; return false to stop the stream
+typedef std::function<bool(int frame_index, const std::string& json, ImageData* frame)> StreamCallback;
+// fills `frame` with the next BGR frame (the pixels are copied), returns false at the end of the stream
+typedef std::function<bool(ImageData* frame)> FrameSource;
 
 class MYYOLOINFERENCE_API MyYoloInference {
- private:
+ public:
   MyYoloInference();
+  MyYoloInference(const MyYoloInference&) = delete;
+  MyYoloInference& operator=(const MyYoloInference&) = delete;
 
- public:
+  // process-wide default engine, used by MY_YOLO and the handle-less C API
   static MyYoloInference& getInstance();
   virtual ~MyYoloInference();
   bool enableCUDA();
+  // metadata is read from the ONNX structure itself, metadata_size is only kept for compatibility
   bool loadModel(const char* path, const int& metadata_size = 2048);
+  // out_json must hold the JSON and its terminator, *out_json_size returns the JSON length
   void getModelInfo(char* out_json, unsigned int* out_json_size);
   bool inference(const char* input_path, const char* output_path);
+  // out_json must hold the JSON and its terminator, *out_json_size returns the JSON length
   bool inference(const void* image_data, unsigned int image_size, char* out_json, unsigned int* out_json_size);
+  // writes at most `capacity` bytes: *needed returns the JSON length plus its terminator, and when that exceeds
+  // `capacity` nothing is written and it returns false
+  bool inference(const void* image_data, unsigned int image_size, char* out_json, unsigned int capacity,
+                 unsigned int* needed);
+  // the JSON stays in a buffer of the library, valid on the calling thread until its next request
+  bool inference(const void* image_data, unsigned int image_size, const char** out_json, unsigned int* out_json_size);
+  // results as a MyYoloResultHeader block; *out_size is the capacity of out on input and the block size on return
+  bool inferenceResults(const void* image_data, unsigned int image_size, void* out, unsigned int* out_size);
+  // the block stays in a buffer of the library, valid on the calling thread until its next request
+  bool inferenceResults(const void* image_data, unsigned int image_size, const void** out, unsigned int* out_size);
+  // class names of the active model, each terminated by '\0'; *out_size is the capacity of out on input and the
+  // size of the names on return
+  bool getClassNames(char* out, unsigned int* out_size);
+  // draws into the caller's pixels only when rendering is on
   bool inference(ImageData* image_data);
+  // results of caller memory as a MyYoloResultHeader block borrowed like above, the pixels are left untouched
+  bool inferenceResults(ImageData* image_data, const void** out, unsigned int* out_size);
+  // batch of `count` images through a single forward, json is an array with one entry per image
+  bool inference(const void** images_data, const unsigned int* images_size, const int& count, char* out_json,
+                 unsigned int* out_json_size);
+  bool inference(ImageData* images_data, const int& count);
+  // queued on the engine's worker threads, the input must stay valid until the request completes;
+  // blocks while the queue is full
+  std::future<std::string> inferenceAsync(const void* image_data, unsigned int image_size);
+  std::future<bool> inferenceAsync(ImageData* image_data);
+  void inferenceAsync(const void* image_data, unsigned int image_size, InferenceCallback callback, void* user_data);
+  // does not wait for the requests already queued, they still run on the previous workers; may be called from a
+  // completion callback
+  void setWorkers(const int& workers, const int& queue_size);
+  // decode, preprocess, forward and postprocess run concurrently on separate threads; blocks until the
+  // stream ends. `source` is anything cv::VideoCapture opens, a plain number selects a camera
+  bool stream(const char* source, const StreamCallback& callback);
+  bool stream(const FrameSource& source, const StreamCallback& callback);
+  // keep N copies of the network so up to N threads can run inference at the same time
+  bool setReplicas(const int& replicas);
+  // run on the given model, loaded on first use and kept resident, without switching the active model
+  bool inference(const char* model_path, const void* image_data, unsigned int image_size, char* out_json,
+                 unsigned int* out_json_size);
+  // loaded models stay resident until their estimated memory exceeds the budget (0 = unlimited),
+  // then the least recently used ones are dropped; the active model always stays and is counted
+  void setMemoryBudget(const size_t& bytes);
   void setModelImgSize(const int& width, const int& height);
   void setNMS(const float& threshold);
+  // NMS only considers the best `max_candidates` boxes and keeps at most `max_det` (0 = no limit), boxes of
+  // different classes only suppress each other when `agnostic` is set
+  void setNMSOptions(const int& max_candidates, const int& max_det, const bool& agnostic);
+  // images larger than `tile_size` are run as overlapping tiles (plus the whole image) and the results merged,
+  // 0 turns it off; uses the batch size the model was exported with
+  void setTiling(const int& tile_size, const int& overlap);
+  // letterbox to the smallest stride-aligned input with the image's aspect ratio instead of the full square,
+  // needs a model exported with dynamic shapes
+  void setRect(const bool& rect);
+  // RENDER_MODE::NONE (default) keeps inference results-only: nothing is drawn and no window is opened;
+  // the path based inference always writes its drawn output image
+  void setRender(const RENDER_MODE& mode);
+  // stream() tracks objects and gives them a track_id: the network runs every `interval` frames (0 = off) and
+  // sooner when a track's confidence decays below `min_confidence`, tracks are predicted in between; detections
+  // scoring `high_threshold` or more start tracks, and tracks unmatched for `max_age` frames end
+  void setTracking(const int& interval, const float& high_threshold = 0.5f, const int& max_age = 30,
+                   const float& min_confidence = 0.2f);
+  // how segment masks are written to JSON, `tolerance` is the polygon simplification in pixels
+  void setMaskFormat(const MASK_FORMAT& format, const float& tolerance = 1.0f);
   void setConfidence(const float& threshold);
   void setClasses(const char** classes, const int& count);
 
@@ -36,12 +151,95 @@ MYYOLOINFERENCE_API bool enableCUDA();
 MYYOLOINFERENCE_API bool loadModel(const char* path, int metadata_size = 2048);
 MYYOLOINFERENCE_API void getModelInfo(char* out_json, unsigned int* out_json_size);
 MYYOLOINFERENCE_API bool inference(const char* input_path, const char* output_path);
+// out_json must hold the JSON and its terminator, *out_json_size returns the JSON length
 MYYOLOINFERENCE_API bool inference_binary(const void* image_data, unsigned int image_size, char* out_json,
                                           unsigned int* out_json_size);
+// bounded: *needed returns the JSON length plus its terminator, nothing is written when it exceeds `capacity`
+MYYOLOINFERENCE_API bool inference_binary_n(const void* image_data, unsigned int image_size, char* out_json,
+                                            unsigned int capacity, unsigned int* needed);
+// *out_json points into a library buffer, valid on the calling thread until its next request
+MYYOLOINFERENCE_API bool inference_binary_borrow(const void* image_data, unsigned int image_size,
+                                                 const char** out_json, unsigned int* out_json_size);
+// results as a MyYoloResultHeader block, *out_size: capacity of out on input, block size on return
+MYYOLOINFERENCE_API bool inference_results(const void* image_data, unsigned int image_size, void* out,
+                                           unsigned int* out_size);
+MYYOLOINFERENCE_API bool inference_results_borrow(const void* image_data, unsigned int image_size, const void** out,
+                                                  unsigned int* out_size);
+// class names of the loaded model indexed by MyYoloResult::class_id, each terminated by '\0', *out_size: capacity
+// of out on input, size of the names on return
+MYYOLOINFERENCE_API bool getClassNames(char* out, unsigned int* out_size);
 MYYOLOINFERENCE_API bool inference_ImageData(my_yolo::ImageData* image_data);
+MYYOLOINFERENCE_API bool inference_ImageData_results(my_yolo::ImageData* image_data, const void** out,
+                                                     unsigned int* out_size);
+MYYOLOINFERENCE_API bool inference_batch_binary(const void** images_data, const unsigned int* images_size, int count,
+                                                char* out_json, unsigned int* out_json_size);
+MYYOLOINFERENCE_API void inference_async(const void* image_data, unsigned int image_size, InferenceCallback callback,
+                                         void* user_data);
+MYYOLOINFERENCE_API bool inference_batch_ImageData(my_yolo::ImageData* images_data, int count);
 MYYOLOINFERENCE_API void setModelImgSize(int width, int height);
 MYYOLOINFERENCE_API void setNMS(float threshold);
+MYYOLOINFERENCE_API void setNMSOptions(int max_candidates, int max_det, bool agnostic);
+MYYOLOINFERENCE_API void setTiling(int tile_size, int overlap);
+MYYOLOINFERENCE_API void setRect(bool rect);
+// mode: 0 results only, 1 draw, 2 draw and show (my_yolo::RENDER_MODE)
+MYYOLOINFERENCE_API void setRender(int mode);
+// stream tracking, interval 0 turns it off (my_yolo::TRACK_OPTIONS)
+MYYOLOINFERENCE_API void setTracking(int interval, float high_threshold, int max_age, float min_confidence);
+// format: 0 PNG, 1 RLE, 2 polygon, 3 bits (my_yolo::MASK_FORMAT)
+MYYOLOINFERENCE_API void setMaskFormat(int format, float tolerance);
 MYYOLOINFERENCE_API void setConfidence(float threshold);
 MYYOLOINFERENCE_API void setClasses(const char** classes, int count);
+
+// handle-based API: every engine owns its own network and model info
+typedef void* MyYoloHandle;
+MYYOLOINFERENCE_API MyYoloHandle createEngine();
+MYYOLOINFERENCE_API void destroyEngine(MyYoloHandle handle);
+MYYOLOINFERENCE_API bool engineEnableCUDA(MyYoloHandle handle);
+MYYOLOINFERENCE_API bool engineLoadModel(MyYoloHandle handle, const char* path, int metadata_size = 2048);
+MYYOLOINFERENCE_API void engineGetModelInfo(MyYoloHandle handle, char* out_json, unsigned int* out_json_size);
+MYYOLOINFERENCE_API bool engineInference(MyYoloHandle handle, const char* input_path, const char* output_path);
+MYYOLOINFERENCE_API bool engineInferenceBinary(MyYoloHandle handle, const void* image_data, unsigned int image_size,
+                                               char* out_json, unsigned int* out_json_size);
+MYYOLOINFERENCE_API bool engineInferenceBinaryN(MyYoloHandle handle, const void* image_data, unsigned int image_size,
+                                                char* out_json, unsigned int capacity, unsigned int* needed);
+MYYOLOINFERENCE_API bool engineInferenceBinaryBorrow(MyYoloHandle handle, const void* image_data,
+                                                     unsigned int image_size, const char** out_json,
+                                                     unsigned int* out_json_size);
+MYYOLOINFERENCE_API bool engineInferenceResults(MyYoloHandle handle, const void* image_data, unsigned int image_size,
+                                                void* out, unsigned int* out_size);
+MYYOLOINFERENCE_API bool engineInferenceResultsBorrow(MyYoloHandle handle, const void* image_data,
+                                                      unsigned int image_size, const void** out,
+                                                      unsigned int* out_size);
+MYYOLOINFERENCE_API bool engineGetClassNames(MyYoloHandle handle, char* out, unsigned int* out_size);
+MYYOLOINFERENCE_API bool engineInferenceImageData(MyYoloHandle handle, my_yolo::ImageData* image_data);
+MYYOLOINFERENCE_API bool engineInferenceImageDataResults(MyYoloHandle handle, my_yolo::ImageData* image_data,
+                                                         const void** out, unsigned int* out_size);
+MYYOLOINFERENCE_API bool engineInferenceBatchBinary(MyYoloHandle handle, const void** images_data,
+                                                    const unsigned int* images_size, int count, char* out_json,
+                                                    unsigned int* out_json_size);
+MYYOLOINFERENCE_API bool engineInferenceBatchImageData(MyYoloHandle handle, my_yolo::ImageData* images_data, int count);
+MYYOLOINFERENCE_API bool engineInferenceAsync(MyYoloHandle handle, const void* image_data, unsigned int image_size,
+                                              InferenceCallback callback, void* user_data);
+typedef bool (*StreamResultCallback)(int frame_index, const char* json, unsigned int json_size,
+                                     my_yolo::ImageData* frame, void* user_data);
+MYYOLOINFERENCE_API bool engineStream(MyYoloHandle handle, const char* source, StreamResultCallback callback,
+                                      void* user_data);
+MYYOLOINFERENCE_API void engineSetWorkers(MyYoloHandle handle, int workers, int queue_size);
+MYYOLOINFERENCE_API bool engineInferenceWithModel(MyYoloHandle handle, const char* model_path, const void* image_data,
+                                                  unsigned int image_size, char* out_json,
+                                                  unsigned int* out_json_size);
+MYYOLOINFERENCE_API void engineSetMemoryBudget(MyYoloHandle handle, unsigned long long bytes);
+MYYOLOINFERENCE_API bool engineSetReplicas(MyYoloHandle handle, int replicas);
+MYYOLOINFERENCE_API void engineSetModelImgSize(MyYoloHandle handle, int width, int height);
+MYYOLOINFERENCE_API void engineSetNMS(MyYoloHandle handle, float threshold);
+MYYOLOINFERENCE_API void engineSetNMSOptions(MyYoloHandle handle, int max_candidates, int max_det, bool agnostic);
+MYYOLOINFERENCE_API void engineSetTiling(MyYoloHandle handle, int tile_size, int overlap);
+MYYOLOINFERENCE_API void engineSetRect(MyYoloHandle handle, bool rect);
+MYYOLOINFERENCE_API void engineSetRender(MyYoloHandle handle, int mode);
+MYYOLOINFERENCE_API void engineSetTracking(MyYoloHandle handle, int interval, float high_threshold, int max_age,
+                                           float min_confidence);
+MYYOLOINFERENCE_API void engineSetMaskFormat(MyYoloHandle handle, int format, float tolerance);
+MYYOLOINFERENCE_API void engineSetConfidence(MyYoloHandle handle, float threshold);
+MYYOLOINFERENCE_API void engineSetClasses(MyYoloHandle handle, const char** classes, int count);
 }
 #endif
@@ -0,0 +1,59 @@
+#include "netpool.h"
+
+#include <iostream>
+
+namespace my_yolo {
+
+bool NetPool::create(const char* model_data, size_t model_size, int replicas, bool cuda) {
+  std::vector<std::unique_ptr<NetReplica>> created;
+  for (int i = 0; i < std::max(1, replicas); ++i) {
+    auto replica = std::make_unique<NetReplica>();
+    try {
+      replica->net = cv::dnn::readNetFromONNX(model_data, model_size);
+    } catch (const cv::Exception& e) {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+    if (replica->net.empty()) {
+      return false;
+    }
+    if (cuda) {
+      replica->net.setPreferableBackend(cv::dnn::DNN_BACKEND_CUDA);
+      replica->net.setPreferableTarget(cv::dnn::DNN_TARGET_CUDA);
+      replica->net.enableFusion(false);
+    } else {
+      replica->net.setPreferableBackend(cv::dnn::DNN_BACKEND_DEFAULT);
+      replica->net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    }
+    replica->output_names = replica->net.getUnconnectedOutLayersNames();
+    created.emplace_back(std::move(replica));
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_replicas = std::move(created);
+  m_free.clear();
+  for (const auto& replica : m_replicas) {
+    m_free.push_back(replica.get());
+  }
+  return true;
+}
+
+int NetPool::size() const { return static_cast<int>(m_replicas.size()); }
+
+NetReplica* NetPool::acquire() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this] { return !m_free.empty(); });
+  NetReplica* replica = m_free.back();
+  m_free.pop_back();
+  return replica;
+}
+
+void NetPool::release(NetReplica* replica) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(replica);
+  }
+  m_cond.notify_one();
+}
+
+}  // namespace my_yolo
@@ -0,0 +1,56 @@
+#ifndef NETPOOL_H
+#define NETPOOL_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <opencv2/dnn.hpp>
+#include <vector>
+
+namespace my_yolo {
+
+// one copy of the loaded network together with the buffers it reads and writes
+struct NetReplica {
+  cv::dnn::Net net;
+  cv::Mat blob;
+  std::vector<cv::Mat> outputs;
+  std::vector<cv::String> output_names;
+  // per image of a batch, views of its share of the outputs, kept while the net hands out the same buffers
+  std::vector<std::vector<cv::Mat>> slices;
+};
+
+class NetPool {
+ public:
+  // RAII handle on a replica, given back to the pool on destruction
+  class Lease {
+   public:
+    Lease(NetPool& pool) : m_pool(pool), m_replica(pool.acquire()) {}
+    ~Lease() { m_pool.release(m_replica); }
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    NetReplica* operator->() const { return m_replica; }
+    NetReplica& operator*() const { return *m_replica; }
+
+   private:
+    NetPool& m_pool;
+    NetReplica* m_replica;
+  };
+
+ public:
+  NetPool() = default;
+  ~NetPool() = default;
+  bool create(const char* model_data, size_t model_size, int replicas, bool cuda);
+  int size() const;
+  NetReplica* acquire();
+  void release(NetReplica* replica);
+
+ private:
+  std::vector<std::unique_ptr<NetReplica>> m_replicas;
+  std::vector<NetReplica*> m_free;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+}  // namespace my_yolo
+
+#endif  // NETPOOL_H
@@ -0,0 +1,65 @@
+#include "nms.h"
+
+#include <algorithm>
+
+namespace my_yolo {
+
+static float iou(const cv::Rect& a, const cv::Rect& b) {
+  int inter = (a & b).area();
+  int total = a.area() + b.area() - inter;
+  return total > 0 ? static_cast<float>(inter) / total : 0.0f;
+}
+
+void NMS::run(const std::vector<cv::Rect>& boxes, const std::vector<float>& scores, const std::vector<int>* classes,
+              const float& score_threshold, const float& nms_threshold, std::vector<int>& indices,
+              const int& max_candidates, const int& max_det) {
+  indices.clear();
+  m_order.clear();
+  for (size_t i = 0; i < scores.size(); ++i) {
+    if (scores[i] > score_threshold) {
+      m_order.push_back(static_cast<int>(i));
+    }
+  }
+  // ties broken by index, the order a stable sort would give without its temporary buffer
+  auto better = [&](int a, int b) { return scores[a] > scores[b] || (scores[a] == scores[b] && a < b); };
+  if (max_candidates > 0 && m_order.size() > (size_t)max_candidates) {
+    // the cost below grows with candidates times kept boxes, cap it on crowded frames
+    std::partial_sort(m_order.begin(), m_order.begin() + max_candidates, m_order.end(), better);
+    m_order.resize(max_candidates);
+  } else {
+    std::sort(m_order.begin(), m_order.end(), better);
+  }
+
+  // boxes of different classes are moved far enough apart that they can never overlap
+  const std::vector<cv::Rect>* candidates = &boxes;
+  if (classes) {
+    int offset = 1;
+    for (int idx : m_order) {
+      offset = std::max(offset, std::max(boxes[idx].br().x, boxes[idx].br().y) + 1);
+    }
+    m_shifted.resize(boxes.size());
+    for (int idx : m_order) {
+      int shift = (*classes)[idx] * offset;
+      m_shifted[idx] = boxes[idx] + cv::Point(shift, shift);
+    }
+    candidates = &m_shifted;
+  }
+
+  for (int idx : m_order) {
+    if (max_det > 0 && indices.size() >= (size_t)max_det) {
+      break;
+    }
+    bool keep = true;
+    for (int kept : indices) {
+      if (iou((*candidates)[idx], (*candidates)[kept]) > nms_threshold) {
+        keep = false;
+        break;
+      }
+    }
+    if (keep) {
+      indices.push_back(idx);
+    }
+  }
+}
+
+}  // namespace my_yolo
@@ -0,0 +1,30 @@
+#ifndef NMS_H
+#define NMS_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace my_yolo {
+
+// greedy non-maximum suppression, class-agnostic it gives the same results as cv::dnn::NMSBoxes; keeps its
+// working memory between calls
+class NMS {
+ public:
+  NMS() = default;
+  ~NMS() = default;
+
+  // with `classes` boxes only suppress boxes of their own class, all classes still go through one pass with the
+  // boxes shifted apart per class; only the `max_candidates` best scores are considered and at most `max_det`
+  // indices are returned, 0 means no limit
+  void run(const std::vector<cv::Rect>& boxes, const std::vector<float>& scores, const std::vector<int>* classes,
+           const float& score_threshold, const float& nms_threshold, std::vector<int>& indices,
+           const int& max_candidates = 0, const int& max_det = 0);
+
+ private:
+  std::vector<int> m_order;
+  std::vector<cv::Rect> m_shifted;
+};
+
+}  // namespace my_yolo
+
+#endif  // NMS_H
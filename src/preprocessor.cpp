@@ -0,0 +1,501 @@
+#include "preprocessor.h"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <vector>
+
+namespace my_yolo {
+
+static constexpr float kPadValue = 114.0f / 255.0f;
+static constexpr float kScale = 1.0f / 255.0f;
+
+// one source image as the kernel reads it
+struct Source {
+  PIXEL_FORMAT format;
+  const uchar* data;
+  int width;
+  int height;
+  size_t stride;
+};
+
+static Source source(const ImageData& image) {
+  PIXEL_FORMAT format = image.format;
+  if (format == PIXEL_FORMAT::BGR && image.channels == 4) {
+    format = PIXEL_FORMAT::BGRA;
+  } else if (format == PIXEL_FORMAT::BGR && image.channels == 1) {
+    format = PIXEL_FORMAT::GRAY;
+  }
+  int cn = 1;
+  if (format == PIXEL_FORMAT::BGR || format == PIXEL_FORMAT::RGB) {
+    cn = 3;
+  } else if (format == PIXEL_FORMAT::BGRA) {
+    cn = 4;
+  }
+  size_t stride = image.stride > 0 ? image.stride : (size_t)image.width * cn;
+  return {format, image.data, image.width, image.height, stride};
+}
+
+#if CV_SIMD
+// 8-bit lanes widened to four vectors of 32-bit lanes
+static inline void expand(const cv::v_uint8& v, cv::v_int32* q) {
+  cv::v_uint16 lo, hi;
+  cv::v_expand(v, lo, hi);
+  cv::v_uint32 w[4];
+  cv::v_expand(lo, w[0], w[1]);
+  cv::v_expand(hi, w[2], w[3]);
+  for (int i = 0; i < 4; ++i) {
+    q[i] = cv::v_reinterpret_as_s32(w[i]);
+  }
+}
+
+static inline void store(float* dst, const cv::v_uint8& v) {
+  const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+  cv::v_int32 q[4];
+  expand(v, q);
+  for (int i = 0; i < 4; ++i) {
+    cv::v_store(dst + i * lanes, cv::v_cvt_f32(q[i]));
+  }
+}
+#endif
+
+// horizontal pass of one packed source row, interpolated in x and written planar in RGB order
+template <int cn, int ri, int gi, int bi>
+static void resamplePacked(const uchar* src, const int* xofs0, const int* xofs1, const float* alpha,
+                           const int& width, float* r, float* g, float* b) {
+  for (int x = 0; x < width; ++x) {
+    const uchar* p0 = src + xofs0[x] * cn;
+    const uchar* p1 = src + xofs1[x] * cn;
+    float a = alpha[x];
+    r[x] = p0[ri] + (p1[ri] - p0[ri]) * a;
+    g[x] = p0[gi] + (p1[gi] - p0[gi]) * a;
+    b[x] = p0[bi] + (p1[bi] - p0[bi]) * a;
+  }
+}
+
+// one packed source row as planar floats in RGB order, gray only fills `r`
+template <int cn, int ri, int gi, int bi>
+static void widenPacked(const uchar* src, const int& width, float* r, float* g, float* b) {
+  int x = 0;
+#if CV_SIMD
+  const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+  for (; x <= width - lanes; x += lanes) {
+    if (cn == 1) {
+      store(r + x, cv::vx_load(src + x));
+      continue;
+    }
+    cv::v_uint8 c[4];
+    if (cn == 3) {
+      cv::v_load_deinterleave(src + x * cn, c[0], c[1], c[2]);
+    } else {
+      cv::v_load_deinterleave(src + x * cn, c[0], c[1], c[2], c[3]);
+    }
+    store(r + x, c[ri]);
+    store(g + x, c[gi]);
+    store(b + x, c[bi]);
+  }
+#endif
+  for (; x < width; ++x) {
+    const uchar* p = src + x * cn;
+    r[x] = p[ri];
+    if (cn > 1) {
+      g[x] = p[gi];
+      b[x] = p[bi];
+    }
+  }
+}
+
+// BT.601 limited range, in the same fixed point cv::cvtColor uses for COLOR_YUV2BGR_NV12 and _I420
+static const int kShift = 20;
+static const int kCY = 1220542;
+static const int kCVR = 1673527;
+static const int kCVG = -852492;
+static const int kCUG = -409993;
+static const int kCUB = 2116026;
+
+static inline void yuv2rgb(const int& y, const int& u, const int& v, float* rgb) {
+  const int kHalf = 1 << (kShift - 1);
+  int cy = std::max(0, y - 16) * kCY;
+  int cu = u - 128;
+  int cv = v - 128;
+  rgb[0] = cv::saturate_cast<uchar>((cy + kCVR * cv + kHalf) >> kShift);
+  rgb[1] = cv::saturate_cast<uchar>((cy + kCVG * cv + kCUG * cu + kHalf) >> kShift);
+  rgb[2] = cv::saturate_cast<uchar>((cy + kCUB * cu + kHalf) >> kShift);
+}
+
+#if CV_SIMD
+static inline void yuv2rgb(const cv::v_int32& y, const cv::v_int32& u, const cv::v_int32& v, float* r, float* g,
+                           float* b) {
+  const cv::v_int32 v_zero = cv::vx_setall_s32(0);
+  const cv::v_int32 v_max = cv::vx_setall_s32(255);
+  const cv::v_int32 v_half = cv::vx_setall_s32(1 << (kShift - 1));
+  const cv::v_int32 v_128 = cv::vx_setall_s32(128);
+  cv::v_int32 cy =
+      cv::v_add(cv::v_mul(cv::v_max(cv::v_sub(y, cv::vx_setall_s32(16)), v_zero), cv::vx_setall_s32(kCY)), v_half);
+  cv::v_int32 cu = cv::v_sub(u, v_128);
+  cv::v_int32 cv = cv::v_sub(v, v_128);
+  cv::v_int32 c[3] = {
+      cv::v_add(cy, cv::v_mul(cv, cv::vx_setall_s32(kCVR))),
+      cv::v_add(cy, cv::v_add(cv::v_mul(cv, cv::vx_setall_s32(kCVG)), cv::v_mul(cu, cv::vx_setall_s32(kCUG)))),
+      cv::v_add(cy, cv::v_mul(cu, cv::vx_setall_s32(kCUB)))};
+  float* dst[3] = {r, g, b};
+  for (int i = 0; i < 3; ++i) {
+    cv::v_int32 q = cv::v_min(cv::v_max(cv::v_shr<kShift>(c[i]), v_zero), v_max);
+    cv::v_store(dst[i], cv::v_cvt_f32(q));
+  }
+}
+#endif
+
+// horizontal pass of one 4:2:0 row, chroma is read every `uv_step` bytes (2 for interleaved NV12)
+static void resampleYUV(const uchar* y_row, const uchar* u_row, const uchar* v_row, const int& uv_step,
+                        const int* xofs0, const int* xofs1, const float* alpha, const int& width, float* r, float* g,
+                        float* b) {
+  for (int x = 0; x < width; ++x) {
+    int x0 = xofs0[x];
+    int x1 = xofs1[x];
+    float c0[3], c1[3];
+    yuv2rgb(y_row[x0], u_row[(x0 >> 1) * uv_step], v_row[(x0 >> 1) * uv_step], c0);
+    yuv2rgb(y_row[x1], u_row[(x1 >> 1) * uv_step], v_row[(x1 >> 1) * uv_step], c1);
+    float a = alpha[x];
+    r[x] = c0[0] + (c1[0] - c0[0]) * a;
+    g[x] = c0[1] + (c1[1] - c0[1]) * a;
+    b[x] = c0[2] + (c1[2] - c0[2]) * a;
+  }
+}
+
+// one 4:2:0 row as planar floats in RGB order, chroma is read every `uv_step` bytes (2 for interleaved NV12)
+static void widenYUV(const uchar* y_row, const uchar* u_row, const uchar* v_row, const int& uv_step,
+                     const int& width, float* r, float* g, float* b) {
+  int x = 0;
+#if CV_SIMD
+  const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+  const int lanes32 = cv::VTraits<cv::v_int32>::vlanes();
+  // one vector of chroma covers two of luma
+  for (; x <= width - 2 * lanes; x += 2 * lanes) {
+    cv::v_uint8 u, v;
+    if (uv_step == 2) {
+      cv::v_load_deinterleave(u_row + x, u, v);
+    } else {
+      u = cv::vx_load(u_row + x / 2);
+      v = cv::vx_load(v_row + x / 2);
+    }
+    cv::v_uint8 us[2], vs[2];
+    cv::v_zip(u, u, us[0], us[1]);
+    cv::v_zip(v, v, vs[0], vs[1]);
+    for (int h = 0; h < 2; ++h) {
+      cv::v_int32 qy[4], qu[4], qv[4];
+      expand(cv::vx_load(y_row + x + h * lanes), qy);
+      expand(us[h], qu);
+      expand(vs[h], qv);
+      for (int i = 0; i < 4; ++i) {
+        int offset = x + h * lanes + i * lanes32;
+        yuv2rgb(qy[i], qu[i], qv[i], r + offset, g + offset, b + offset);
+      }
+    }
+  }
+#endif
+  for (; x < width; ++x) {
+    float c[3];
+    yuv2rgb(y_row[x], u_row[(x >> 1) * uv_step], v_row[(x >> 1) * uv_step], c);
+    r[x] = c[0];
+    g[x] = c[1];
+    b[x] = c[2];
+  }
+}
+
+// horizontal pass of one widened plane, the taps are gathered with v_lut
+static void taps(const float* src, const int* xofs0, const int* xofs1, const float* alpha, const int& width,
+                 float* dst) {
+  int x = 0;
+#if CV_SIMD
+  const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+  for (; x <= width - lanes; x += lanes) {
+    cv::v_float32 p0 = cv::v_lut(src, xofs0 + x);
+    cv::v_float32 p1 = cv::v_lut(src, xofs1 + x);
+    cv::v_store(dst + x, cv::v_muladd(cv::v_sub(p1, p0), cv::vx_load(alpha + x), p0));
+  }
+#endif
+  for (; x < width; ++x) {
+    float p0 = src[xofs0[x]];
+    dst[x] = p0 + (src[xofs1[x]] - p0) * alpha[x];
+  }
+}
+
+// widening converts every source pixel once, when the source is more than twice as wide as the output most of them
+// are never tapped and the taps are read straight from the row instead
+static bool widens(const int& src_width, const int& width) { return src_width <= 2 * width; }
+
+// the taps of source row `y` read straight from the row
+static void resampleDirect(const Source& src, const int& y, const int* xofs0, const int* xofs1, const float* alpha,
+                           const int& width, float* r, float* g, float* b) {
+  const uchar* row = src.data + (size_t)y * src.stride;
+  const uchar* chroma = src.data + (size_t)src.height * src.stride;
+  switch (src.format) {
+    case PIXEL_FORMAT::BGR:
+      resamplePacked<3, 2, 1, 0>(row, xofs0, xofs1, alpha, width, r, g, b);
+      break;
+    case PIXEL_FORMAT::BGRA:
+      resamplePacked<4, 2, 1, 0>(row, xofs0, xofs1, alpha, width, r, g, b);
+      break;
+    case PIXEL_FORMAT::RGB:
+      resamplePacked<3, 0, 1, 2>(row, xofs0, xofs1, alpha, width, r, g, b);
+      break;
+    case PIXEL_FORMAT::GRAY:
+      resamplePacked<1, 0, 0, 0>(row, xofs0, xofs1, alpha, width, r, g, b);
+      break;
+    case PIXEL_FORMAT::NV12: {
+      const uchar* uv = chroma + (size_t)(y / 2) * src.stride;
+      resampleYUV(row, uv, uv + 1, 2, xofs0, xofs1, alpha, width, r, g, b);
+      break;
+    }
+    case PIXEL_FORMAT::I420: {
+      size_t chroma_stride = src.stride / 2;
+      const uchar* u = chroma + (size_t)(y / 2) * chroma_stride;
+      const uchar* v = u + (size_t)((src.height + 1) / 2) * chroma_stride;
+      resampleYUV(row, u, v, 1, xofs0, xofs1, alpha, width, r, g, b);
+      break;
+    }
+  }
+}
+
+// converts source row `y` to RGB while resampling it, so no full-resolution BGR copy is ever made; unless the
+// source is read directly, `wide` holds the row as three float planes of the source width in between
+static void resampleRow(const Source& src, const int& y, const int* xofs0, const int* xofs1, const float* alpha,
+                        const int& width, float* r, float* g, float* b, float* wide) {
+  if (!widens(src.width, width)) {
+    resampleDirect(src, y, xofs0, xofs1, alpha, width, r, g, b);
+    return;
+  }
+  const uchar* row = src.data + (size_t)y * src.stride;
+  const uchar* chroma = src.data + (size_t)src.height * src.stride;
+  float* planes[3] = {wide, wide + src.width, wide + 2 * (size_t)src.width};
+  switch (src.format) {
+    case PIXEL_FORMAT::BGR:
+      widenPacked<3, 2, 1, 0>(row, src.width, planes[0], planes[1], planes[2]);
+      break;
+    case PIXEL_FORMAT::BGRA:
+      widenPacked<4, 2, 1, 0>(row, src.width, planes[0], planes[1], planes[2]);
+      break;
+    case PIXEL_FORMAT::RGB:
+      widenPacked<3, 0, 1, 2>(row, src.width, planes[0], planes[1], planes[2]);
+      break;
+    case PIXEL_FORMAT::GRAY:
+      widenPacked<1, 0, 0, 0>(row, src.width, planes[0], nullptr, nullptr);
+      taps(planes[0], xofs0, xofs1, alpha, width, r);
+      std::copy(r, r + width, g);
+      std::copy(r, r + width, b);
+      return;
+    case PIXEL_FORMAT::NV12: {
+      const uchar* uv = chroma + (size_t)(y / 2) * src.stride;
+      widenYUV(row, uv, uv + 1, 2, src.width, planes[0], planes[1], planes[2]);
+      break;
+    }
+    case PIXEL_FORMAT::I420: {
+      size_t chroma_stride = src.stride / 2;
+      const uchar* u = chroma + (size_t)(y / 2) * chroma_stride;
+      const uchar* v = u + (size_t)((src.height + 1) / 2) * chroma_stride;
+      widenYUV(row, u, v, 1, src.width, planes[0], planes[1], planes[2]);
+      break;
+    }
+  }
+  taps(planes[0], xofs0, xofs1, alpha, width, r);
+  taps(planes[1], xofs0, xofs1, alpha, width, g);
+  taps(planes[2], xofs0, xofs1, alpha, width, b);
+}
+
+// dst = row0 * w0 + row1 * w1, the 1/255 scaling is folded into the weights
+static void blendRows(const float* row0, const float* row1, const float& w0, const float& w1, const int& width,
+                      float* dst) {
+  int x = 0;
+#if CV_SIMD
+  const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+  cv::v_float32 v_w0 = cv::vx_setall_f32(w0);
+  cv::v_float32 v_w1 = cv::vx_setall_f32(w1);
+  cv::v_float32 v_zero = cv::vx_setzero_f32();
+  for (; x <= width - lanes; x += lanes) {
+    cv::v_float32 t = cv::v_muladd(cv::vx_load(row1 + x), v_w1, v_zero);
+    cv::v_store(dst + x, cv::v_muladd(cv::vx_load(row0 + x), v_w0, t));
+  }
+#endif
+  for (; x < width; ++x) {
+    dst[x] = row0[x] * w0 + row1[x] * w1;
+  }
+}
+
+static void letterbox(const Source& image, cv::Mat& blob, const cv::Size& size, const int& index,
+                      const int& batch) {
+  CV_Assert(index < batch);
+  int blob_shape[] = {batch, 3, size.height, size.width};
+  blob.create(4, blob_shape, CV_32F);
+
+  // letterbox geometry, identical to blobFromImageWithParams
+  float resize_factor = std::min(size.width / (float)image.width, size.height / (float)image.height);
+  int rh = int(image.height * resize_factor);
+  int rw = int(image.width * resize_factor);
+  int top = (size.height - rh) / 2;
+  int left = (size.width - rw) / 2;
+
+  // bilinear source positions per output column, as cv::resize INTER_LINEAR maps them
+  thread_local std::vector<int> xofs0, xofs1;
+  thread_local std::vector<float> alpha;
+  xofs0.resize(rw);
+  xofs1.resize(rw);
+  alpha.resize(rw);
+  double scale_x = (double)image.width / rw;
+  double scale_y = (double)image.height / rh;
+  for (int x = 0; x < rw; ++x) {
+    float sx = (float)((x + 0.5) * scale_x - 0.5);
+    int x0 = cvFloor(sx);
+    float a = sx - x0;
+    if (x0 < 0) {
+      x0 = 0;
+      a = 0;
+    }
+    if (x0 >= image.width - 1) {
+      x0 = image.width - 1;
+      a = 0;
+    }
+    xofs0[x] = x0;
+    xofs1[x] = std::min(x0 + 1, image.width - 1);
+    alpha[x] = a;
+  }
+
+  size_t plane = (size_t)size.width * size.height;
+  float* planes[3];
+  for (int c = 0; c < 3; ++c) {
+    planes[c] = blob.ptr<float>() + ((size_t)index * 3 + c) * plane;
+  }
+  const int* p_xofs0 = xofs0.data();
+  const int* p_xofs1 = xofs1.data();
+  const float* p_alpha = alpha.data();
+
+  cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range& range) {
+    thread_local std::vector<float> rows;
+    // the widened row is at most six output rows wide
+    rows.resize(6 * (size_t)rw + (widens(image.width, rw) ? 3 * (size_t)image.width : 0));
+    float* wide = rows.data() + 6 * (size_t)rw;
+    float* row0[3] = {rows.data(), rows.data() + rw, rows.data() + 2 * rw};
+    float* row1[3] = {rows.data() + 3 * rw, rows.data() + 4 * rw, rows.data() + 5 * rw};
+    int cached_y0 = -1;
+    int cached_y1 = -1;
+
+    for (int y = range.start; y < range.end; ++y) {
+      float* dst[3] = {planes[0] + (size_t)y * size.width, planes[1] + (size_t)y * size.width,
+                       planes[2] + (size_t)y * size.width};
+      if (y < top || y >= top + rh) {
+        for (int c = 0; c < 3; ++c) {
+          std::fill(dst[c], dst[c] + size.width, kPadValue);
+        }
+        continue;
+      }
+
+      float sy = (float)((y - top + 0.5) * scale_y - 0.5);
+      int y0 = cvFloor(sy);
+      float fy = sy - y0;
+      if (y0 < 0) {
+        y0 = 0;
+        fy = 0;
+      }
+      if (y0 >= image.height - 1) {
+        y0 = image.height - 1;
+        fy = 0;
+      }
+      int y1 = std::min(y0 + 1, image.height - 1);
+
+      // neighbouring output rows often share source rows when upscaling
+      if (y0 != cached_y0) {
+        if (y0 == cached_y1) {
+          std::swap(row0[0], row1[0]);
+          std::swap(row0[1], row1[1]);
+          std::swap(row0[2], row1[2]);
+        } else {
+          resampleRow(image, y0, p_xofs0, p_xofs1, p_alpha, rw, row0[0], row0[1], row0[2], wide);
+        }
+        cached_y0 = y0;
+        cached_y1 = -1;
+      }
+      if (y1 != cached_y1) {
+        resampleRow(image, y1, p_xofs0, p_xofs1, p_alpha, rw, row1[0], row1[1], row1[2], wide);
+        cached_y1 = y1;
+      }
+
+      for (int c = 0; c < 3; ++c) {
+        std::fill(dst[c], dst[c] + left, kPadValue);
+        blendRows(row0[c], row1[c], (1.0f - fy) * kScale, fy * kScale, rw, dst[c] + left);
+        std::fill(dst[c] + left + rw, dst[c] + size.width, kPadValue);
+      }
+    }
+  });
+}
+
+void Preprocessor::run(const cv::Mat& image, cv::Mat& blob, const cv::Size& size, const int& index,
+                       const int& batch) {
+  CV_Assert(supports(image));
+  PIXEL_FORMAT format = PIXEL_FORMAT::BGR;
+  if (image.channels() == 4) {
+    format = PIXEL_FORMAT::BGRA;
+  } else if (image.channels() == 1) {
+    format = PIXEL_FORMAT::GRAY;
+  }
+  letterbox({format, image.data, image.cols, image.rows, image.step}, blob, size, index, batch);
+}
+
+void Preprocessor::run(const ImageData& image, cv::Mat& blob, const cv::Size& size, const int& index,
+                       const int& batch) {
+  letterbox(source(image), blob, size, index, batch);
+}
+
+void Preprocessor::run(const std::vector<cv::Mat>& images, cv::Mat& blob, const cv::Size& size) {
+  for (size_t i = 0; i < images.size(); ++i) {
+    run(images[i], blob, size, i, images.size());
+  }
+}
+
+cv::Size Preprocessor::rectSize(const cv::Size& image, const cv::Size& model, const int& stride) {
+  int s = std::max(1, stride);
+  float r = std::max(model.width, model.height) / (float)std::max(image.width, image.height);
+  int w = std::min(model.width, (int)std::ceil(image.width * r / s) * s);
+  int h = std::min(model.height, (int)std::ceil(image.height * r / s) * s);
+  // never larger than the model input, a non-square model keeps its own shape as the upper bound
+  return cv::Size(std::max(w, s), std::max(h, s));
+}
+
+bool Preprocessor::supports(const cv::Mat& image) {
+  return image.depth() == CV_8U && (image.channels() == 1 || image.channels() == 3 || image.channels() == 4);
+}
+
+cv::Mat Preprocessor::view(const ImageData& image) {
+  Source src = source(image);
+  int type = CV_8UC1;
+  if (src.format == PIXEL_FORMAT::BGR || src.format == PIXEL_FORMAT::RGB) {
+    type = CV_8UC3;
+  } else if (src.format == PIXEL_FORMAT::BGRA) {
+    type = CV_8UC4;
+  }
+  return cv::Mat(src.height, src.width, type, image.data, src.stride);
+}
+
+void Preprocessor::toBGR(const ImageData& image, cv::Mat& bgr) {
+  Source src = source(image);
+  cv::Mat yuv(src.height * 3 / 2, src.width, CV_8UC1, image.data, src.stride);
+  switch (src.format) {
+    case PIXEL_FORMAT::BGR:
+      view(image).copyTo(bgr);
+      break;
+    case PIXEL_FORMAT::BGRA:
+      cv::cvtColor(view(image), bgr, cv::COLOR_BGRA2BGR);
+      break;
+    case PIXEL_FORMAT::RGB:
+      cv::cvtColor(view(image), bgr, cv::COLOR_RGB2BGR);
+      break;
+    case PIXEL_FORMAT::GRAY:
+      cv::cvtColor(view(image), bgr, cv::COLOR_GRAY2BGR);
+      break;
+    case PIXEL_FORMAT::NV12:
+      cv::cvtColor(yuv, bgr, cv::COLOR_YUV2BGR_NV12);
+      break;
+    case PIXEL_FORMAT::I420:
+      cv::cvtColor(yuv, bgr, cv::COLOR_YUV2BGR_I420);
+      break;
+  }
+}
+
+}  // namespace my_yolo
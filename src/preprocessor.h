@@ -0,0 +1,36 @@
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <opencv2/opencv.hpp>
+
+#include "definitions.h"
+#include "global.h"
+
+namespace my_yolo {
+
+// letterbox resize, border fill, color conversion to RGB, 1/255 scaling and HWC->CHW in one pass, same geometry
+// as cv::dnn::blobFromImageWithParams with DNN_PMODE_LETTERBOX
+class MYYOLOINFERENCE_API Preprocessor {
+ public:
+  // writes `image` (8-bit BGR, BGRA or GRAY) into slot `index` of a [batch, 3, size.height, size.width] float
+  // blob, the blob is only reallocated when its shape changes
+  static void run(const cv::Mat& image, cv::Mat& blob, const cv::Size& size, const int& index = 0,
+                  const int& batch = 1);
+  static void run(const std::vector<cv::Mat>& images, cv::Mat& blob, const cv::Size& size);
+  // same for caller memory in any PIXEL_FORMAT, read in place with its stride
+  static void run(const ImageData& image, cv::Mat& blob, const cv::Size& size, const int& index = 0,
+                  const int& batch = 1);
+
+  // smallest input with the image's aspect ratio whose long side matches the model's and whose sides are
+  // multiples of `stride`, e.g. 640x384 for 1920x1080 on a 640x640 model
+  static cv::Size rectSize(const cv::Size& image, const cv::Size& model, const int& stride);
+
+  static bool supports(const cv::Mat& image);
+  // header over the caller's pixels to draw on, the luma plane for YUV formats
+  static cv::Mat view(const ImageData& image);
+  static void toBGR(const ImageData& image, cv::Mat& bgr);
+};
+
+}  // namespace my_yolo
+
+#endif  // PREPROCESSOR_H
@@ -0,0 +1,87 @@
+#include "resultblock.h"
+
+#include <cstring>
+
+#include "my-yolo-inference.h"
+
+namespace my_yolo {
+
+// row-major runs of the mask, outside first
+static void runs(const cv::Mat& mask, std::vector<uint32_t>& out) {
+  bool inside = false;
+  uint32_t run = 0;
+  for (int y = 0; y < mask.rows; ++y) {
+    const uchar* row = mask.ptr<uchar>(y);
+    for (int x = 0; x < mask.cols; ++x) {
+      if ((row[x] != 0) != inside) {
+        out.push_back(run);
+        run = 0;
+        inside = !inside;
+      }
+      ++run;
+    }
+  }
+  out.push_back(run);
+}
+
+void ResultBlock::pack(const std::vector<YOLO_RESULT>& results, const TASK& task, std::vector<unsigned char>& out) {
+  thread_local std::vector<MyYoloResult> items;
+  thread_local std::vector<MyYoloKeypoint> keypoints;
+  thread_local std::vector<uint32_t> masks;
+  items.clear();
+  keypoints.clear();
+  masks.clear();
+
+  for (const auto& res : results) {
+    MyYoloResult item{};
+    item.class_id = res.class_idx;
+    item.score = res.confidence;
+    item.x = res.bbox.x;
+    item.y = res.bbox.y;
+    item.w = res.bbox.width;
+    item.h = res.bbox.height;
+    if (task == TASK::OBB) {
+      item.cx = res.obb.center.x;
+      item.cy = res.obb.center.y;
+      item.rw = res.obb.size.width;
+      item.rh = res.obb.size.height;
+      item.angle = res.angle;
+    }
+    item.keypoint_index = keypoints.size();
+    item.keypoint_count = res.keypoints.size();
+    for (const auto& kp : res.keypoints) {
+      keypoints.push_back({kp.x, kp.y});
+    }
+    item.mask_index = masks.size();
+    if (!res.mask.empty()) {
+      runs(res.mask, masks);
+    }
+    item.mask_run_count = masks.size() - item.mask_index;
+    items.push_back(item);
+  }
+
+  MyYoloResultHeader header{};
+  header.version = MY_YOLO_RESULT_VERSION;
+  header.task = static_cast<int32_t>(task);
+  header.count = items.size();
+  header.results_offset = sizeof(MyYoloResultHeader);
+  header.keypoints_offset = header.results_offset + items.size() * sizeof(MyYoloResult);
+  header.keypoint_count = keypoints.size();
+  header.masks_offset = header.keypoints_offset + keypoints.size() * sizeof(MyYoloKeypoint);
+  header.mask_run_count = masks.size();
+  header.size = header.masks_offset + masks.size() * sizeof(uint32_t);
+
+  out.resize(header.size);
+  std::memcpy(out.data(), &header, sizeof(header));
+  if (!items.empty()) {
+    std::memcpy(out.data() + header.results_offset, items.data(), items.size() * sizeof(MyYoloResult));
+  }
+  if (!keypoints.empty()) {
+    std::memcpy(out.data() + header.keypoints_offset, keypoints.data(), keypoints.size() * sizeof(MyYoloKeypoint));
+  }
+  if (!masks.empty()) {
+    std::memcpy(out.data() + header.masks_offset, masks.data(), masks.size() * sizeof(uint32_t));
+  }
+}
+
+}  // namespace my_yolo
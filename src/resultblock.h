@@ -0,0 +1,22 @@
+#ifndef RESULTBLOCK_H
+#define RESULTBLOCK_H
+
+#include <vector>
+
+#include "definitions.h"
+
+namespace my_yolo {
+
+// packs results into the flat block of the binary result API (MyYoloResultHeader and what follows it)
+class ResultBlock {
+ public:
+  ResultBlock() = default;
+  ~ResultBlock() = default;
+
+  // `out` is overwritten and keeps its capacity
+  static void pack(const std::vector<YOLO_RESULT>& results, const TASK& task, std::vector<unsigned char>& out);
+};
+
+}  // namespace my_yolo
+
+#endif  // RESULTBLOCK_H
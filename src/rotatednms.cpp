@@ -0,0 +1,168 @@
+#include "rotatednms.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace my_yolo {
+
+static constexpr int kMaxVertices = 16;
+
+static inline float cross(const cv::Point2f& o, const cv::Point2f& a, const cv::Point2f& b) {
+  return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static float polygonArea(const cv::Point2f* pts, const int& n) {
+  float area = 0.0f;
+  for (int i = 0; i < n; ++i) {
+    const cv::Point2f& p = pts[i];
+    const cv::Point2f& q = pts[(i + 1) % n];
+    area += p.x * q.y - q.x * p.y;
+  }
+  return std::abs(area) * 0.5f;
+}
+
+float RotatedNMS::iou(const cv::Point2f* a, const float& area_a, const cv::Point2f* b, const float& area_b) {
+  // Sutherland-Hodgman: clip `a` by every edge of the convex `b`, ping-ponging between two stack buffers
+  cv::Point2f buffers[2][kMaxVertices];
+  cv::Point2f* poly = buffers[0];
+  cv::Point2f* next = buffers[1];
+  int n = 4;
+  std::copy(a, a + 4, poly);
+  // which side of b's edges is inside depends on the winding of its corners
+  float orientation = cross(b[0], b[1], b[2]) >= 0 ? 1.0f : -1.0f;
+
+  for (int e = 0; e < 4 && n > 0; ++e) {
+    const cv::Point2f& p0 = b[e];
+    const cv::Point2f& p1 = b[(e + 1) % 4];
+    int m = 0;
+    for (int i = 0; i < n; ++i) {
+      const cv::Point2f& cur = poly[i];
+      const cv::Point2f& prev = poly[(i + n - 1) % n];
+      float d_cur = cross(p0, p1, cur) * orientation;
+      float d_prev = cross(p0, p1, prev) * orientation;
+      if (d_cur >= 0) {
+        if (d_prev < 0 && m < kMaxVertices) {
+          next[m++] = prev + (cur - prev) * (d_prev / (d_prev - d_cur));
+        }
+        if (m < kMaxVertices) {
+          next[m++] = cur;
+        }
+      } else if (d_prev >= 0 && m < kMaxVertices) {
+        next[m++] = prev + (cur - prev) * (d_prev / (d_prev - d_cur));
+      }
+    }
+    std::swap(poly, next);
+    n = m;
+  }
+  if (n < 3) {
+    return 0.0f;
+  }
+  float inter = polygonArea(poly, n);
+  float uni = area_a + area_b - inter;
+  return uni > 0 ? inter / uni : 0.0f;
+}
+
+void RotatedNMS::run(const std::vector<cv::RotatedRect>& boxes, const std::vector<float>& scores,
+                     const std::vector<int>* classes, const float& score_threshold, const float& nms_threshold,
+                     std::vector<int>& indices, const int& max_candidates, const int& max_det) {
+  indices.clear();
+  m_order.clear();
+  for (size_t i = 0; i < scores.size(); ++i) {
+    if (scores[i] > score_threshold) {
+      m_order.push_back(static_cast<int>(i));
+    }
+  }
+  auto better = [&](int a, int b) { return scores[a] > scores[b] || (scores[a] == scores[b] && a < b); };
+  if (max_candidates > 0 && m_order.size() > (size_t)max_candidates) {
+    std::partial_sort(m_order.begin(), m_order.begin() + max_candidates, m_order.end(), better);
+    m_order.resize(max_candidates);
+  } else {
+    std::sort(m_order.begin(), m_order.end(), better);
+  }
+  if (m_order.empty()) {
+    return;
+  }
+
+  // corners, bounds and areas once per candidate instead of once per pair
+  m_candidates.resize(boxes.size());
+  float cell = 1.0f;
+  cv::Point2f lo(FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX);
+  for (int idx : m_order) {
+    Candidate& c = m_candidates[idx];
+    boxes[idx].points(c.corners);
+    float x0 = c.corners[0].x, x1 = c.corners[0].x, y0 = c.corners[0].y, y1 = c.corners[0].y;
+    for (int k = 1; k < 4; ++k) {
+      x0 = std::min(x0, c.corners[k].x);
+      x1 = std::max(x1, c.corners[k].x);
+      y0 = std::min(y0, c.corners[k].y);
+      y1 = std::max(y1, c.corners[k].y);
+    }
+    c.aabb = cv::Rect2f(x0, y0, x1 - x0, y1 - y0);
+    c.center = boxes[idx].center;
+    c.radius = 0.5f * std::sqrt(boxes[idx].size.width * boxes[idx].size.width +
+                                boxes[idx].size.height * boxes[idx].size.height);
+    c.area = boxes[idx].size.area();
+    cell = std::max(cell, std::max(c.aabb.width, c.aabb.height));
+    lo.x = std::min(lo.x, x0);
+    lo.y = std::min(lo.y, y0);
+    hi.x = std::max(hi.x, x1);
+    hi.y = std::max(hi.y, y1);
+  }
+
+  // grid with cells as large as the largest box, so a box spans at most 2x2 cells and overlapping boxes always
+  // share one
+  int cols = std::max(1, (int)std::ceil((hi.x - lo.x) / cell) + 1);
+  int rows = std::max(1, (int)std::ceil((hi.y - lo.y) / cell) + 1);
+  m_cells.resize((size_t)cols * rows);
+  for (auto& bucket : m_cells) {
+    bucket.clear();
+  }
+  auto span = [&](const cv::Rect2f& r, int& cx0, int& cy0, int& cx1, int& cy1) {
+    cx0 = std::min(cols - 1, (int)((r.x - lo.x) / cell));
+    cy0 = std::min(rows - 1, (int)((r.y - lo.y) / cell));
+    cx1 = std::min(cols - 1, (int)((r.x + r.width - lo.x) / cell));
+    cy1 = std::min(rows - 1, (int)((r.y + r.height - lo.y) / cell));
+  };
+
+  for (int idx : m_order) {
+    if (max_det > 0 && indices.size() >= (size_t)max_det) {
+      break;
+    }
+    const Candidate& c = m_candidates[idx];
+    int cx0, cy0, cx1, cy1;
+    span(c.aabb, cx0, cy0, cx1, cy1);
+
+    bool keep = true;
+    for (int gy = cy0; gy <= cy1 && keep; ++gy) {
+      for (int gx = cx0; gx <= cx1 && keep; ++gx) {
+        for (int kept : m_cells[(size_t)gy * cols + gx]) {
+          if (classes && (*classes)[kept] != (*classes)[idx]) {
+            continue;
+          }
+          const Candidate& k = m_candidates[kept];
+          cv::Point2f d = c.center - k.center;
+          float reach = c.radius + k.radius;
+          if (d.x * d.x + d.y * d.y > reach * reach || (c.aabb & k.aabb).empty()) {
+            continue;
+          }
+          if (iou(c.corners, c.area, k.corners, k.area) > nms_threshold) {
+            keep = false;
+            break;
+          }
+        }
+      }
+    }
+    if (!keep) {
+      continue;
+    }
+    indices.push_back(idx);
+    for (int gy = cy0; gy <= cy1; ++gy) {
+      for (int gx = cx0; gx <= cx1; ++gx) {
+        m_cells[(size_t)gy * cols + gx].push_back(idx);
+      }
+    }
+  }
+}
+
+}  // namespace my_yolo
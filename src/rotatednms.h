@@ -0,0 +1,43 @@
+#ifndef ROTATEDNMS_H
+#define ROTATEDNMS_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "global.h"
+
+namespace my_yolo {
+
+// greedy NMS over rotated boxes: a bounding circle and AABB test rejects most pairs, a grid over the kept boxes
+// limits the comparisons to neighbours, and the remaining pairs are intersected by clipping one rectangle with
+// the other on the stack; keeps its working memory between calls
+class MYYOLOINFERENCE_API RotatedNMS {
+ public:
+  RotatedNMS() = default;
+  ~RotatedNMS() = default;
+
+  // same conventions as NMS::run: `classes` makes it per class, `max_candidates` and `max_det` of 0 mean no limit
+  void run(const std::vector<cv::RotatedRect>& boxes, const std::vector<float>& scores,
+           const std::vector<int>* classes, const float& score_threshold, const float& nms_threshold,
+           std::vector<int>& indices, const int& max_candidates = 0, const int& max_det = 0);
+
+  // intersection over union of two rotated rectangles given as 4 corners in order
+  static float iou(const cv::Point2f* a, const float& area_a, const cv::Point2f* b, const float& area_b);
+
+ private:
+  struct Candidate {
+    cv::Point2f corners[4];
+    cv::Rect2f aabb;
+    cv::Point2f center;
+    float radius;
+    float area;
+  };
+
+  std::vector<int> m_order;
+  std::vector<Candidate> m_candidates;
+  std::vector<std::vector<int>> m_cells;
+};
+
+}  // namespace my_yolo
+
+#endif  // ROTATEDNMS_H
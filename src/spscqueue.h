@@ -0,0 +1,90 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace my_yolo {
+
+// lock-free ring buffer for exactly one producer thread and one consumer thread; push on a full queue and pop on
+// an empty one sleep on a condition variable instead of spinning, the other side only takes the lock to wake them
+template <typename T>
+class SPSCQueue {
+ public:
+  explicit SPSCQueue(const size_t& capacity) : m_buffer(capacity + 1) {}
+
+  bool tryPush(const T& value) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t next = (head + 1) % m_buffer.size();
+    if (next == m_tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    m_buffer[head] = value;
+    m_head.store(next, std::memory_order_release);
+    wake();
+    return true;
+  }
+
+  bool tryPop(T& value) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = m_buffer[tail];
+    m_tail.store((tail + 1) % m_buffer.size(), std::memory_order_release);
+    wake();
+    return true;
+  }
+
+  void push(const T& value) {
+    while (!tryPush(value)) {
+      sleep([this]() {
+        return (m_head.load(std::memory_order_relaxed) + 1) % m_buffer.size() !=
+               m_tail.load(std::memory_order_acquire);
+      });
+    }
+  }
+
+  T pop() {
+    T value;
+    while (!tryPop(value)) {
+      sleep([this]() { return m_tail.load(std::memory_order_relaxed) != m_head.load(std::memory_order_acquire); });
+    }
+    return value;
+  }
+
+ private:
+  // the fences pair up: either the sleeper sees the update, or the updater sees the sleeper and notifies it
+  template <typename Ready>
+  void sleep(const Ready& ready) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_sleepers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_cond.wait(lock, ready);
+    m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleepers.load(std::memory_order_relaxed) != 0) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_cond.notify_all();
+    }
+  }
+
+ private:
+  std::vector<T> m_buffer;
+  alignas(64) std::atomic<size_t> m_head{0};
+  alignas(64) std::atomic<size_t> m_tail{0};
+  // a count, as both sides may briefly be inside sleep() at once
+  std::atomic<int> m_sleepers{0};
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+};
+
+}  // namespace my_yolo
+
+#endif  // SPSCQUEUE_H
@@ -0,0 +1,62 @@
+#include "streampipeline.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "spscqueue.h"
+
+namespace my_yolo {
+
+StreamPipeline::StreamPipeline(const int& slots) : m_slots(std::max(4, slots)) {}
+
+void StreamPipeline::run(const Stage& decode, const Stage& preprocess, const Stage& forward, const Stage& postprocess) {
+  std::vector<std::unique_ptr<StreamFrame>> frames;
+  SPSCQueue<StreamFrame*> free_frames(m_slots);
+  SPSCQueue<StreamFrame*> decoded(m_slots);
+  SPSCQueue<StreamFrame*> preprocessed(m_slots);
+  SPSCQueue<StreamFrame*> forwarded(m_slots);
+  for (int i = 0; i < m_slots; ++i) {
+    frames.emplace_back(std::make_unique<StreamFrame>());
+    free_frames.push(frames.back().get());
+  }
+  std::atomic<bool> stop{false};
+
+  // nullptr marks the end of the stream
+  auto stage = [](SPSCQueue<StreamFrame*>& in, SPSCQueue<StreamFrame*>& out, const Stage& fn) {
+    while (StreamFrame* frame = in.pop()) {
+      if (frame->ok) {
+        frame->ok = fn(*frame);
+      }
+      out.push(frame);
+    }
+    out.push(nullptr);
+  };
+
+  std::thread preprocess_thread(stage, std::ref(decoded), std::ref(preprocessed), std::cref(preprocess));
+  std::thread forward_thread(stage, std::ref(preprocessed), std::ref(forwarded), std::cref(forward));
+  std::thread postprocess_thread([&]() {
+    while (StreamFrame* frame = forwarded.pop()) {
+      if (!stop && !postprocess(*frame)) {
+        stop = true;
+      }
+      free_frames.push(frame);
+    }
+  });
+
+  while (!stop) {
+    StreamFrame* frame = free_frames.pop();
+    frame->ok = true;
+    if (!decode(*frame)) {
+      break;
+    }
+    decoded.push(frame);
+  }
+  decoded.push(nullptr);
+
+  preprocess_thread.join();
+  forward_thread.join();
+  postprocess_thread.join();
+}
+
+}  // namespace my_yolo
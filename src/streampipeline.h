@@ -0,0 +1,42 @@
+#ifndef STREAMPIPELINE_H
+#define STREAMPIPELINE_H
+
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace my_yolo {
+
+// one frame travelling through the pipeline, slots are recycled once the last stage is done with them
+struct StreamFrame {
+  int index = 0;
+  bool ok = true;
+  // false when the frame skips forward, its results are predicted by the tracker
+  bool detect = true;
+  // the blob already holds this frame
+  bool prepared = false;
+  cv::Mat image;
+  cv::Mat blob;
+  std::vector<cv::Mat> outputs;
+};
+
+// decode -> preprocess -> forward -> postprocess, every stage on its own thread
+class StreamPipeline {
+ public:
+  using Stage = std::function<bool(StreamFrame&)>;
+
+ public:
+  StreamPipeline(const int& slots = 6);
+  ~StreamPipeline() = default;
+
+  // decode runs on the calling thread and returns false at the end of the stream, postprocess sees the frames
+  // in order and returns false to stop early; a failing preprocess/forward marks the frame as not ok
+  void run(const Stage& decode, const Stage& preprocess, const Stage& forward, const Stage& postprocess);
+
+ private:
+  int m_slots;
+};
+
+}  // namespace my_yolo
+
+#endif  // STREAMPIPELINE_H
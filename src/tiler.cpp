@@ -0,0 +1,131 @@
+#include "tiler.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace my_yolo {
+
+static std::vector<int> positions(const int& length, const int& tile_size, const int& step) {
+  std::vector<int> pos{0};
+  while (pos.back() + tile_size < length) {
+    pos.emplace_back(std::min(pos.back() + step, length - tile_size));
+  }
+  return pos;
+}
+
+std::vector<cv::Rect> Tiler::tiles(const cv::Size& image, const int& tile_size, const int& overlap) {
+  int step = std::max(1, tile_size - std::max(0, overlap));
+  std::vector<cv::Rect> rects;
+  for (int y : positions(image.height, tile_size, step)) {
+    for (int x : positions(image.width, tile_size, step)) {
+      rects.emplace_back(cv::Rect(x, y, tile_size, tile_size) & cv::Rect(0, 0, image.width, image.height));
+    }
+  }
+  return rects;
+}
+
+void Tiler::offset(std::vector<YOLO_RESULT>& results, const cv::Point& origin) {
+  cv::Point2f shift(origin.x, origin.y);
+  for (auto& res : results) {
+    res.bbox += origin;
+    res.obb.center += shift;
+    for (auto& kp : res.keypoints) {
+      // keypoints below the confidence threshold stay at (-1, -1)
+      if (kp.x >= 0 && kp.y >= 0) {
+        kp += shift;
+      }
+    }
+  }
+}
+
+// pixels from a tile border within which a box counts as cut by it
+static const int kSeamMargin = 2;
+
+bool Tiler::seam(const YOLO_RESULT& result, const cv::Rect& tile, const cv::Size& image) {
+  const cv::Rect& box = result.bbox;
+  return (tile.x > 0 && box.x <= tile.x + kSeamMargin) ||
+         (tile.y > 0 && box.y <= tile.y + kSeamMargin) ||
+         (tile.br().x < image.width && box.br().x >= tile.br().x - kSeamMargin) ||
+         (tile.br().y < image.height && box.br().y >= tile.br().y - kSeamMargin);
+}
+
+// intersection over the smaller box, or over the union
+static float overlap(const YOLO_RESULT& a, const YOLO_RESULT& b, const bool& rotated, const bool& smaller) {
+  float inter, area_a, area_b;
+  if (!rotated) {
+    inter = (a.bbox & b.bbox).area();
+    area_a = a.bbox.area();
+    area_b = b.bbox.area();
+  } else {
+    if ((a.bbox & b.bbox).empty()) {
+      return 0.0f;
+    }
+    std::vector<cv::Point2f> inter_pts;
+    if (cv::rotatedRectangleIntersection(a.obb, b.obb, inter_pts) == cv::INTERSECT_NONE || inter_pts.size() < 3) {
+      return 0.0f;
+    }
+    inter = cv::contourArea(inter_pts);
+    area_a = a.obb.size.area();
+    area_b = b.obb.size.area();
+  }
+  float denominator = smaller ? std::min(area_a, area_b) : area_a + area_b - inter;
+  return denominator > 0 ? inter / denominator : 0.0f;
+}
+
+// grows `kept` to also cover `piece`, another part of the same object cut by a different tile
+static void unite(YOLO_RESULT& kept, const YOLO_RESULT& piece) {
+  cv::Rect box = kept.bbox | piece.bbox;
+  if (!kept.mask.empty() || !piece.mask.empty()) {
+    // masks have the size of their box, both are placed into one of the united box
+    if (kept.mask.size() != kept.bbox.size() || piece.mask.size() != piece.bbox.size()) {
+      return;
+    }
+    cv::Mat mask = cv::Mat::zeros(box.size(), kept.mask.type());
+    kept.mask.copyTo(mask(cv::Rect(kept.bbox.tl() - box.tl(), kept.bbox.size())));
+    cv::Mat part = mask(cv::Rect(piece.bbox.tl() - box.tl(), piece.bbox.size()));
+    cv::bitwise_or(part, piece.mask, part);
+    kept.mask = mask;
+  }
+  kept.bbox = box;
+  // keypoints hidden on one side of the seam may be visible on the other
+  for (int i = 0; i < std::min(kept.keypoints.size(), piece.keypoints.size()); ++i) {
+    if ((kept.keypoints[i].x < 0 || kept.keypoints[i].y < 0) && piece.keypoints[i].x >= 0 &&
+        piece.keypoints[i].y >= 0) {
+      kept.keypoints[i] = piece.keypoints[i];
+    }
+  }
+}
+
+void Tiler::merge(std::vector<YOLO_RESULT>& results, const std::vector<bool>& seams, const float& threshold,
+                  const bool& rotated) {
+  std::vector<int> order(results.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const int& a, const int& b) {
+    if (seams[a] != seams[b]) {
+      return !seams[a];
+    }
+    return results[a].confidence > results[b].confidence;
+  });
+
+  std::vector<YOLO_RESULT> kept;
+  std::vector<bool> kept_seams;
+  for (int i : order) {
+    YOLO_RESULT& res = results[i];
+    int match = -1;
+    for (size_t k = 0; k < kept.size() && match < 0; ++k) {
+      bool cut = seams[i] || kept_seams[k];
+      if (kept[k].class_idx == res.class_idx && overlap(kept[k], res, rotated, cut) > threshold) {
+        match = k;
+      }
+    }
+    if (match < 0) {
+      kept.emplace_back(std::move(res));
+      kept_seams.push_back(seams[i]);
+    } else if (seams[i] && kept_seams[match] && !rotated) {
+      unite(kept[match], res);
+    }
+  }
+  results = std::move(kept);
+}
+
+}  // namespace my_yolo
@@ -0,0 +1,34 @@
+#ifndef TILER_H
+#define TILER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "definitions.h"
+
+namespace my_yolo {
+
+// cuts large images into overlapping tiles and merges what was found on them back into one result
+class Tiler {
+ public:
+  Tiler() = default;
+  ~Tiler() = default;
+
+  // tiles of `tile_size` covering the image, neighbours share at least `overlap` pixels; the last row and
+  // column are aligned to the image border instead of running past it
+  static std::vector<cv::Rect> tiles(const cv::Size& image, const int& tile_size, const int& overlap);
+  // moves results from tile to image coordinates
+  static void offset(std::vector<YOLO_RESULT>& results, const cv::Point& origin);
+  // whether a result (in image coordinates) touches a border of `tile` that lies inside the image, so it may be
+  // cut by the tile
+  static bool seam(const YOLO_RESULT& result, const cv::Rect& tile, const cv::Size& image);
+  // greedy class-aware merge, complete detections first and by confidence; a detection on a seam folds into one
+  // covering most of it (intersection over the smaller box), two pieces on seams are joined into their union, and
+  // complete detections only suppress each other by IoU, so a small object inside a larger box survives
+  static void merge(std::vector<YOLO_RESULT>& results, const std::vector<bool>& seams, const float& threshold,
+                    const bool& rotated);
+};
+
+}  // namespace my_yolo
+
+#endif  // TILER_H
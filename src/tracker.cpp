@@ -0,0 +1,260 @@
+#include "tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "rotatednms.h"
+
+namespace my_yolo {
+
+// noise of the box coordinates relative to its size, as in ByteTrack, and of the angle in degrees
+static const float kStdPosition = 1.0f / 20;
+static const float kStdVelocity = 1.0f / 160;
+static const float kStdAngle = 2.0f;
+static const float kStdAngleVelocity = 0.5f;
+// IoU a match needs with a confident detection, and with a low scoring one
+static const float kHighIoU = 0.2f;
+static const float kLowIoU = 0.5f;
+// confidence of a track lost per frame without a matching detection
+static const float kDecay = 0.9f;
+
+void Tracker::Filter::init(const float& z, const float& sp, const float& sv) {
+  p = z;
+  v = 0;
+  pp = 4 * sp * sp;
+  pv = 0;
+  vv = 100 * sv * sv;
+}
+
+void Tracker::Filter::predict(const float& qp, const float& qv) {
+  p += v;
+  pp += 2 * pv + vv + qp * qp;
+  pv += vv;
+  vv += qv * qv;
+}
+
+void Tracker::Filter::update(const float& z, const float& r) {
+  float s = pp + r * r;
+  float kp = pp / s;
+  float kv = pv / s;
+  float y = z - p;
+  p += kp * y;
+  v += kv * y;
+  vv -= kv * pv;
+  pv -= kp * pv;
+  pp -= kp * pp;
+}
+
+cv::Rect2f Tracker::Track::box() const {
+  float w = std::max(f[W].p, 0.0f);
+  float h = std::max(f[H].p, 0.0f);
+  return cv::Rect2f(f[CX].p - w / 2, f[CY].p - h / 2, w, h);
+}
+
+cv::RotatedRect Tracker::Track::obb() const {
+  return cv::RotatedRect(cv::Point2f(f[CX].p, f[CY].p),
+                         cv::Size2f(std::max(f[W].p, 0.0f), std::max(f[H].p, 0.0f)), f[ANGLE].p);
+}
+
+float Tracker::Track::confidence() const { return score * std::pow(kDecay, since); }
+
+// center, size and angle a detection measures
+static void measure(const YOLO_RESULT& result, const bool& rotated, float* z) {
+  if (rotated) {
+    z[0] = result.obb.center.x;
+    z[1] = result.obb.center.y;
+    z[2] = result.obb.size.width;
+    z[3] = result.obb.size.height;
+    z[4] = result.obb.angle;
+  } else {
+    z[0] = result.bbox.x + result.bbox.width / 2.0f;
+    z[1] = result.bbox.y + result.bbox.height / 2.0f;
+    z[2] = result.bbox.width;
+    z[3] = result.bbox.height;
+    z[4] = 0;
+  }
+}
+
+static float iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+  float inter = (a & b).area();
+  float area = a.area() + b.area() - inter;
+  return area > 0 ? inter / area : 0;
+}
+
+void Tracker::start(Track& track, const YOLO_RESULT& result, const bool& rotated) {
+  float z[DIMS];
+  measure(result, rotated, z);
+  float s = std::max(z[W], z[H]);
+  for (int d = 0; d < ANGLE; ++d) {
+    track.f[d].init(z[d], kStdPosition * s, kStdVelocity * s);
+  }
+  track.f[ANGLE].init(z[ANGLE], kStdAngle, kStdAngleVelocity);
+  track.id = m_next_id++;
+  keep(track, result, z);
+}
+
+void Tracker::correct(Track& track, const YOLO_RESULT& result, const bool& rotated) {
+  float z[DIMS];
+  measure(result, rotated, z);
+  float s = std::max(z[W], z[H]);
+  for (int d = 0; d < ANGLE; ++d) {
+    track.f[d].update(z[d], kStdPosition * s);
+  }
+  // a rotated box is the same every 180 degrees, the measured angle is taken closest to the predicted one
+  float turn = z[ANGLE] - track.f[ANGLE].p;
+  turn -= 180.0f * std::round(turn / 180.0f);
+  track.f[ANGLE].update(track.f[ANGLE].p + turn, kStdAngle);
+  keep(track, result, z);
+}
+
+void Tracker::keep(Track& track, const YOLO_RESULT& result, const float* z) {
+  track.class_idx = result.class_idx;
+  track.score = result.confidence;
+  track.since = 0;
+  track.followed = true;
+  track.keypoints.clear();
+  for (const auto& kp : result.keypoints) {
+    if (kp.x < 0 || kp.y < 0 || z[W] <= 0 || z[H] <= 0) {
+      track.keypoints.push_back({std::numeric_limits<float>::quiet_NaN(), 0});
+    } else {
+      track.keypoints.push_back({(kp.x - z[CX]) / z[W], (kp.y - z[CY]) / z[H]});
+    }
+  }
+}
+
+void Tracker::match(const std::vector<YOLO_RESULT>& results, const bool& high, const float& high_threshold,
+                    const float& min_iou, const bool& rotated, const bool& agnostic) {
+  m_pairs.clear();
+  for (int t = 0; t < static_cast<int>(m_tracks.size()); ++t) {
+    const Track& track = m_tracks[t];
+    // low scoring detections only extend tracks that are being followed
+    if (m_track_match[t] >= 0 || (!high && !track.followed)) {
+      continue;
+    }
+    cv::Rect2f box = track.box();
+    cv::Point2f corners[4];
+    float area = 0;
+    if (rotated) {
+      cv::RotatedRect obb = track.obb();
+      obb.points(corners);
+      area = obb.size.area();
+    }
+    for (int r = 0; r < static_cast<int>(results.size()); ++r) {
+      const YOLO_RESULT& result = results[r];
+      if (m_result_match[r] >= 0 || (result.confidence >= high_threshold) != high ||
+          (!agnostic && result.class_idx != track.class_idx)) {
+        continue;
+      }
+      float overlap;
+      if (rotated) {
+        cv::Point2f other[4];
+        result.obb.points(other);
+        overlap = RotatedNMS::iou(corners, area, other, result.obb.size.area());
+      } else {
+        overlap = iou(box, result.bbox);
+      }
+      if (overlap >= min_iou) {
+        m_pairs.push_back({overlap, t, r});
+      }
+    }
+  }
+
+  std::sort(m_pairs.begin(), m_pairs.end(), [](const Pair& a, const Pair& b) { return a.iou > b.iou; });
+  for (const auto& pair : m_pairs) {
+    if (m_track_match[pair.track] < 0 && m_result_match[pair.result] < 0) {
+      m_track_match[pair.track] = pair.result;
+      m_result_match[pair.result] = pair.track;
+    }
+  }
+}
+
+void Tracker::update(std::vector<YOLO_RESULT>& results, const TRACK_OPTIONS& options, const bool& rotated,
+                     const bool& agnostic) {
+  advance();
+
+  m_track_match.assign(m_tracks.size(), -1);
+  m_result_match.assign(results.size(), -1);
+  match(results, true, options.high_threshold, kHighIoU, rotated, agnostic);
+  match(results, false, options.high_threshold, kLowIoU, rotated, agnostic);
+
+  for (size_t t = 0; t < m_tracks.size(); ++t) {
+    Track& track = m_tracks[t];
+    int r = m_track_match[t];
+    if (r >= 0) {
+      correct(track, results[r], rotated);
+      results[r].track_id = track.id;
+    } else {
+      track.followed = false;
+    }
+  }
+  m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(),
+                                [&options](const Track& track) { return track.since > options.max_age; }),
+                 m_tracks.end());
+
+  for (size_t r = 0; r < results.size(); ++r) {
+    if (m_result_match[r] < 0 && results[r].confidence >= options.high_threshold) {
+      m_tracks.emplace_back();
+      start(m_tracks.back(), results[r], rotated);
+      results[r].track_id = m_tracks.back().id;
+    }
+  }
+}
+
+void Tracker::advance() {
+  for (auto& track : m_tracks) {
+    float s = std::max(track.f[W].p, track.f[H].p);
+    for (int d = 0; d < ANGLE; ++d) {
+      track.f[d].predict(kStdPosition * s, kStdVelocity * s);
+    }
+    track.f[ANGLE].predict(kStdAngle, kStdAngleVelocity);
+    ++track.since;
+  }
+}
+
+void Tracker::predict(std::vector<YOLO_RESULT>& results, const cv::Size& size) {
+  advance();
+  results.clear();
+  cv::Rect2f bounds(0, 0, size.width, size.height);
+  for (const auto& track : m_tracks) {
+    if (!track.followed) {
+      continue;
+    }
+    YOLO_RESULT result;
+    result.class_idx = track.class_idx;
+    result.confidence = track.confidence();
+    cv::Rect2f box = track.box();
+    result.bbox = box & bounds;
+    if (result.bbox.empty()) {
+      continue;
+    }
+    result.obb = track.obb();
+    result.angle = track.f[ANGLE].p;
+    for (const auto& kp : track.keypoints) {
+      if (std::isnan(kp.x)) {
+        result.keypoints.push_back({-1, -1});
+      } else {
+        result.keypoints.push_back({track.f[CX].p + kp.x * box.width, track.f[CY].p + kp.y * box.height});
+      }
+    }
+    result.track_id = track.id;
+    results.push_back(result);
+  }
+}
+
+float Tracker::confidence() const {
+  float lowest = 1.0f;
+  for (const auto& track : m_tracks) {
+    if (track.followed) {
+      lowest = std::min(lowest, track.confidence());
+    }
+  }
+  return lowest;
+}
+
+void Tracker::reset() {
+  m_tracks.clear();
+  m_next_id = 1;
+}
+
+}  // namespace my_yolo
@@ -0,0 +1,89 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "definitions.h"
+#include "global.h"
+
+namespace my_yolo {
+
+// ByteTrack style multi-object tracker: every track runs a constant velocity Kalman filter over its box center,
+// size and angle, detections are matched to the predicted boxes by IoU, confident ones first and the rest only to
+// tracks still being followed; keeps its working memory between frames
+class MYYOLOINFERENCE_API Tracker {
+ public:
+  Tracker() = default;
+  ~Tracker() = default;
+
+  // frame with detections: advances the tracks one frame, matches `results` to them and sets their track_id,
+  // unmatched confident detections start new tracks; `rotated` compares obb instead of bbox
+  void update(std::vector<YOLO_RESULT>& results, const TRACK_OPTIONS& options, const bool& rotated,
+              const bool& agnostic);
+  // frame without detections: advances the tracks one frame and writes the followed ones to `results`, boxes
+  // clipped to `size`
+  void predict(std::vector<YOLO_RESULT>& results, const cv::Size& size);
+  // lowest confidence of the tracks being followed, 1 without any
+  float confidence() const;
+  void reset();
+
+ private:
+  // position and velocity of one coordinate, with their covariance
+  struct Filter {
+    float p = 0;
+    float v = 0;
+    float pp = 0;
+    float pv = 0;
+    float vv = 0;
+
+    void init(const float& z, const float& sp, const float& sv);
+    void predict(const float& qp, const float& qv);
+    void update(const float& z, const float& r);
+  };
+
+  enum { CX = 0, CY, W, H, ANGLE, DIMS };
+
+  struct Track {
+    int id;
+    int class_idx;
+    // score of the last matching detection, and frames since then
+    float score;
+    int since;
+    // matched at the last detection frame
+    bool followed;
+    Filter f[DIMS];
+    // keypoints relative to the box center in units of its size, so they move and scale with it
+    KEYPOINTS keypoints;
+
+    cv::Rect2f box() const;
+    cv::RotatedRect obb() const;
+    float confidence() const;
+  };
+
+  struct Pair {
+    float iou;
+    int track;
+    int result;
+  };
+
+  // moves every track one frame ahead
+  void advance();
+  void start(Track& track, const YOLO_RESULT& result, const bool& rotated);
+  void correct(Track& track, const YOLO_RESULT& result, const bool& rotated);
+  // class, score and keypoints of the detection `z` was measured from
+  static void keep(Track& track, const YOLO_RESULT& result, const float* z);
+  // greedy matching of the unmatched `results` to the unmatched tracks by descending IoU
+  void match(const std::vector<YOLO_RESULT>& results, const bool& high, const float& high_threshold,
+             const float& min_iou, const bool& rotated, const bool& agnostic);
+
+  std::vector<Track> m_tracks;
+  std::vector<Pair> m_pairs;
+  std::vector<int> m_track_match;
+  std::vector<int> m_result_match;
+  int m_next_id = 1;
+};
+
+}  // namespace my_yolo
+
+#endif  // TRACKER_H
@@ -10,6 +10,9 @@ class Utils {
   Utils();
   ~Utils();
 
+  // peak resident set size of the process so far, in KB
+  static size_t PeakRSS();
+
   static std::string Img2Base64(const cv::Mat& img) {
     // encode as PNG
     std::vector<uchar> buf;
@@ -0,0 +1,60 @@
+#include "workerpool.h"
+
+#include <algorithm>
+
+namespace my_yolo {
+
+WorkerPool::WorkerPool(const int& workers, const int& capacity) : m_state(std::make_shared<State>()) {
+  m_state->capacity = std::max(1, capacity);
+  for (int i = 0; i < std::max(1, workers); ++i) {
+    m_threads.emplace_back(&WorkerPool::loop, m_state);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    m_state->stop = true;
+  }
+  m_state->not_empty.notify_all();
+  // queued tasks are still run before the threads exit
+  for (auto& t : m_threads) {
+    if (t.get_id() == std::this_thread::get_id()) {
+      t.detach();
+    } else {
+      t.join();
+    }
+  }
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+  {
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    m_state->not_full.wait(lock, [this] { return m_state->queue.size() < m_state->capacity; });
+    m_state->queue.emplace_back(std::move(task));
+  }
+  m_state->not_empty.notify_one();
+}
+
+int WorkerPool::workers() const { return static_cast<int>(m_threads.size()); }
+
+int WorkerPool::capacity() const { return static_cast<int>(m_state->capacity); }
+
+void WorkerPool::loop(const std::shared_ptr<State>& state) {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(state->mutex);
+      state->not_empty.wait(lock, [&state] { return state->stop || !state->queue.empty(); });
+      if (state->queue.empty()) {
+        return;
+      }
+      task = std::move(state->queue.front());
+      state->queue.pop_front();
+    }
+    state->not_full.notify_one();
+    task();
+  }
+}
+
+}  // namespace my_yolo
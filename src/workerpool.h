@@ -0,0 +1,48 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace my_yolo {
+
+// fixed set of threads fed by a bounded queue, submit() blocks while the queue is full
+class WorkerPool {
+ public:
+  WorkerPool(const int& workers, const int& capacity);
+  // blocks until the queued tasks have run, except when called from one of the pool's own tasks: that thread is
+  // left to finish the queue on its own
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  void submit(std::function<void()> task);
+  int workers() const;
+  int capacity() const;
+
+ private:
+  // shared with the threads, so a detached one never outlives what it works on
+  struct State {
+    std::deque<std::function<void()>> queue;
+    size_t capacity;
+    bool stop = false;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+  };
+
+  static void loop(const std::shared_ptr<State>& state);
+
+ private:
+  std::shared_ptr<State> m_state;
+  std::vector<std::thread> m_threads;
+};
+
+}  // namespace my_yolo
+
+#endif  // WORKERPOOL_H